@@ -0,0 +1,391 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <memory>
+#include <new>
+#include <string>
+
+// Counts every call to the global operator new so the benchmark can show how
+// many heap allocations each history implementation performs. All the plain
+// and array forms are replaced together so every allocation is paired with
+// the matching deallocation. They are kept out of line: once inlined, GCC
+// sees malloc() paired with operator delete (or operator new with free()) and
+// warns about mismatched allocation functions.
+static std::size_t g_allocations = 0;
+
+static void* CountedAlloc(std::size_t size) {
+    ++g_allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new(std::size_t size) {
+    return CountedAlloc(size);
+}
+
+__attribute__((noinline)) void* operator new[](std::size_t size) {
+    return CountedAlloc(size);
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// Every snapshot in the arena starts with a fixed-size header. The tag
+// identifies the kind of originator that wrote the snapshot, so restoring is a
+// plain integer comparison instead of a dynamic_cast. The header also links to
+// the previous snapshot, which turns the arena into an intrusive stack.
+struct MementoHeader {
+    std::uint32_t tag;
+    std::uint32_t size;
+    std::uint64_t prev;
+    std::int64_t date;
+
+    const char* payload() const {
+        return reinterpret_cast<const char*>(this + 1);
+    }
+};
+
+// The MementoArena keeps all snapshots back to back in one contiguous buffer.
+// The buffer only grows geometrically, so after warm-up Backup and Undo never
+// touch the heap, and popping a snapshot just moves the top offset back.
+class MementoArena {
+public:
+    static constexpr std::uint64_t kNone = ~std::uint64_t(0);
+
+    explicit MementoArena(std::size_t reserve_bytes = 0) {
+        buffer_.reserve(reserve_bytes);
+    }
+
+    // Appends a header for a snapshot of |size| bytes and returns a pointer to
+    // the payload area the caller has to fill in.
+    char* Push(std::uint32_t tag, std::uint32_t size) {
+        std::size_t offset = end_;
+        std::size_t record = sizeof(MementoHeader) + Align(size);
+        if (buffer_.size() < offset + record) {
+            buffer_.resize(std::max(offset + record, buffer_.size() * 2));
+        }
+
+        MementoHeader* header = reinterpret_cast<MementoHeader*>(buffer_.data() + offset);
+        header->tag = tag;
+        header->size = size;
+        header->prev = top_;
+        header->date = std::chrono::system_clock::now().time_since_epoch().count();
+
+        top_ = offset;
+        end_ = offset + record;
+        ++count_;
+        return reinterpret_cast<char*>(header + 1);
+    }
+
+    const MementoHeader* Top() const {
+        return top_ == kNone ? nullptr : At(top_);
+    }
+
+    void Pop() {
+        if (top_ == kNone) {
+            return;
+        }
+        end_ = top_;
+        top_ = At(top_)->prev;
+        --count_;
+    }
+
+    // Walks the history from the newest snapshot to the oldest one.
+    template <typename Fn>
+    void ForEach(Fn fn) const {
+        for (std::uint64_t offset = top_; offset != kNone; offset = At(offset)->prev) {
+            fn(*At(offset));
+        }
+    }
+
+    std::size_t size() const {
+        return count_;
+    }
+
+    std::size_t bytes_used() const {
+        return end_;
+    }
+
+private:
+    static std::size_t Align(std::size_t n) {
+        return (n + alignof(MementoHeader) - 1) & ~(alignof(MementoHeader) - 1);
+    }
+
+    const MementoHeader* At(std::uint64_t offset) const {
+        return reinterpret_cast<const MementoHeader*>(buffer_.data() + offset);
+    }
+
+    std::vector<char> buffer_;
+    std::uint64_t top_ = kNone;
+    std::size_t end_ = 0;
+    std::size_t count_ = 0;
+};
+
+// The Originator serializes its state straight into the arena and only
+// accepts snapshots carrying its own tag.
+class Originator {
+private:
+    std::string state_;
+
+public:
+    static constexpr std::uint32_t kTag = 0x4f524947;  // "ORIG"
+
+    // DoSomething() needs at least one character to flip.
+    Originator(const std::string& state) : state_(state) {
+        if (state_.empty()) {
+            throw std::invalid_argument("Originator: the state must not be empty");
+        }
+    }
+
+    // Flips one character of the state, standing in for real business logic
+    // without the cost of generating a whole new string.
+    void DoSomething(std::size_t step) {
+        char& c = state_[step % state_.size()];
+        c = c == 'z' ? 'a' : static_cast<char>(c + 1);
+    }
+
+    const std::string& state() const {
+        return state_;
+    }
+
+    void Save(MementoArena& arena) const {
+        // The header stores the size in 32 bits.
+        if (state_.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("Originator: state too large for a snapshot");
+        }
+        char* payload = arena.Push(kTag, static_cast<std::uint32_t>(state_.size()));
+        std::memcpy(payload, state_.data(), state_.size());
+    }
+
+    // Returns false instead of throwing when the snapshot belongs to somebody
+    // else, so the caller can simply move on to the next one.
+    bool Restore(const MementoHeader& memento) {
+        if (memento.tag != kTag) {
+            return false;
+        }
+        state_.assign(memento.payload(), memento.size);
+        return true;
+    }
+};
+
+// The Caretaker owns the arena. Undo is a loop that discards foreign or
+// unreadable snapshots until one restores successfully.
+class Caretaker {
+private:
+    MementoArena arena_;
+    Originator* originator_;
+    bool verbose_;
+
+public:
+    Caretaker(Originator* originator, std::size_t reserve_bytes = 0, bool verbose = true)
+        : arena_(reserve_bytes), originator_(originator), verbose_(verbose) {
+    }
+
+    MementoArena& arena() {
+        return arena_;
+    }
+
+    void Backup() {
+        if (verbose_) {
+            std::cout << "Caretaker: Saving Originator's state..." << std::endl;
+        }
+        originator_->Save(arena_);
+    }
+
+    bool Undo() {
+        while (const MementoHeader* memento = arena_.Top()) {
+            bool restored = originator_->Restore(*memento);
+            if (verbose_) {
+                std::cout << "Caretaker: " << (restored ? "Restored" : "Skipped foreign")
+                          << " memento " << memento->date << std::endl;
+            }
+            arena_.Pop();
+            if (restored) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ShowHistory() const {
+        std::cout << "Caretaker: Here's the list of mementos (newest first):" << std::endl;
+        arena_.ForEach([](const MementoHeader& memento) {
+            std::cout << memento.date << " / (" << std::string(memento.payload(), std::min<std::size_t>(memento.size, 9))
+                      << ")..." << std::endl;
+        });
+    }
+};
+
+// The classic design from Memento.cpp, stripped of its console output, kept
+// here as the benchmark baseline.
+namespace classic {
+
+class IMemento {
+public:
+    virtual std::string GetState() const = 0;
+    virtual ~IMemento() {}
+};
+
+class ConcreteMemento : public IMemento {
+private:
+    std::string state_;
+    std::chrono::system_clock::time_point date_;
+
+public:
+    ConcreteMemento(const std::string& state)
+        : state_(state), date_(std::chrono::system_clock::now()) {
+    }
+
+    std::string GetState() const override {
+        return state_;
+    }
+};
+
+class Originator {
+private:
+    std::string state_;
+
+public:
+    // DoSomething() needs at least one character to flip.
+    Originator(const std::string& state) : state_(state) {
+        if (state_.empty()) {
+            throw std::invalid_argument("Originator: the state must not be empty");
+        }
+    }
+
+    void DoSomething(std::size_t step) {
+        char& c = state_[step % state_.size()];
+        c = c == 'z' ? 'a' : static_cast<char>(c + 1);
+    }
+
+    const std::string& state() const {
+        return state_;
+    }
+
+    std::unique_ptr<IMemento> Save() {
+        return std::make_unique<ConcreteMemento>(state_);
+    }
+
+    void Restore(const IMemento* memento) {
+        const ConcreteMemento* concreteMemento = dynamic_cast<const ConcreteMemento*>(memento);
+        if (concreteMemento == nullptr) {
+            throw std::runtime_error("Unknown memento class");
+        }
+        state_ = concreteMemento->GetState();
+    }
+};
+
+class Caretaker {
+private:
+    std::vector<std::unique_ptr<IMemento>> mementos_;
+    Originator* originator_;
+
+public:
+    Caretaker(Originator* originator) : originator_(originator) {
+    }
+
+    void Backup() {
+        mementos_.push_back(originator_->Save());
+    }
+
+    void Undo() {
+        if (mementos_.empty()) {
+            return;
+        }
+        std::unique_ptr<IMemento> memento = std::move(mementos_.back());
+        mementos_.pop_back();
+        try {
+            originator_->Restore(memento.get());
+        } catch (const std::runtime_error&) {
+            Undo();
+        }
+    }
+};
+
+}  // namespace classic
+
+template <typename OriginatorT, typename CaretakerT>
+void RunBenchmark(const char* name, OriginatorT& originator, CaretakerT& caretaker, std::size_t cycles) {
+    using Clock = std::chrono::steady_clock;
+
+    std::size_t allocations = g_allocations;
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < cycles; ++i) {
+        originator.DoSomething(i);
+        caretaker.Backup();
+    }
+    Clock::time_point middle = Clock::now();
+    for (std::size_t i = 0; i < cycles; ++i) {
+        caretaker.Undo();
+    }
+    Clock::time_point end = Clock::now();
+    allocations = g_allocations - allocations;
+
+    double backup_ns = std::chrono::duration<double, std::nano>(middle - start).count() / cycles;
+    double undo_ns = std::chrono::duration<double, std::nano>(end - middle).count() / cycles;
+    std::cout << name << ": " << cycles << " cycles, Backup " << backup_ns << " ns/op, Undo " << undo_ns
+              << " ns/op, " << allocations << " heap allocations, final state " << originator.state() << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    // Client code.
+    Originator* originator = new Originator("Super-duper-super-puper-super.");
+    Caretaker* caretaker = new Caretaker(originator);
+
+    caretaker->Backup();
+    originator->DoSomething(0);
+    caretaker->Backup();
+    originator->DoSomething(1);
+
+    // A snapshot written by some other originator sharing the same history.
+    std::memcpy(caretaker->arena().Push(0x464f524e, 5), "alien", 5);
+    originator->DoSomething(2);
+
+    std::cout << std::endl;
+    caretaker->ShowHistory();
+
+    std::cout << "\nClient: Now, let's rollback!\n" << std::endl;
+    caretaker->Undo();
+    std::cout << "Originator: My state is: " << originator->state() << std::endl;
+
+    std::cout << "\nClient: Once more!\n" << std::endl;
+    caretaker->Undo();
+    std::cout << "Originator: My state is: " << originator->state() << std::endl;
+
+    delete caretaker;
+    delete originator;
+
+    std::size_t cycles = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    std::cout << "\nBenchmark: " << cycles << " Backup/Undo cycles\n" << std::endl;
+
+    classic::Originator classicOriginator("Super-duper-super-puper-super.");
+    classic::Caretaker classicCaretaker(&classicOriginator);
+    RunBenchmark("unique_ptr + dynamic_cast", classicOriginator, classicCaretaker, cycles);
+
+    Originator arenaOriginator("Super-duper-super-puper-super.");
+    Caretaker arenaCaretaker(&arenaOriginator, cycles * (sizeof(MementoHeader) + 32), false);
+    RunBenchmark("tagged arena             ", arenaOriginator, arenaCaretaker, cycles);
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+#include <iostream>
+#include <deque>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <typeinfo>
+#include <memory>
+#include <string>
+
+// The Memento interface provides a way to retrieve the memento's metadata,
+// such as creation date or name. However, it doesn't expose the
+// Originator's state.
+class IMemento {
+public:
+    virtual std::string GetName() const = 0;
+    virtual std::string GetState() const = 0;
+    virtual std::chrono::system_clock::time_point GetDate() const = 0;
+    virtual ~IMemento() {}
+};
+
+// The ConcreteMemento contains the infrastructure for storing the
+// Originator's state. The date can be supplied explicitly so that histories
+// can be replayed or simulated.
+class ConcreteMemento : public IMemento {
+private:
+    std::string state_;
+    std::chrono::system_clock::time_point date_;
+
+public:
+    ConcreteMemento(const std::string& state,
+                    std::chrono::system_clock::time_point date = std::chrono::system_clock::now())
+        : state_(state), date_(date) {
+    }
+
+    std::string GetState() const override {
+        return state_;
+    }
+
+    std::string GetName() const override {
+        return std::to_string(date_.time_since_epoch().count()) + " / (" + state_.substr(0, 9) + ")...";
+    }
+
+    std::chrono::system_clock::time_point GetDate() const override {
+        return date_;
+    }
+};
+
+class Originator {
+private:
+    std::string state_;
+
+public:
+    Originator(const std::string& state) : state_(state) {
+    }
+
+    void set_state(const std::string& state) {
+        state_ = state;
+    }
+
+    const std::string& state() const {
+        return state_;
+    }
+
+    std::unique_ptr<IMemento> Save(std::chrono::system_clock::time_point date = std::chrono::system_clock::now()) {
+        return std::make_unique<ConcreteMemento>(state_, date);
+    }
+
+    void Restore(const IMemento* memento) {
+        const ConcreteMemento* concreteMemento = dynamic_cast<const ConcreteMemento*>(memento);
+        if (concreteMemento == nullptr) {
+            throw std::runtime_error("Unknown memento class " + std::string(typeid(*memento).name()));
+        }
+
+        state_ = concreteMemento->GetState();
+    }
+};
+
+// The TimeIndexedCaretaker keeps, next to the mementos, a sorted array of
+// their dates. Because snapshots are appended in time order the index never
+// needs re-sorting, and any point in time can be found with a binary search
+// instead of replaying Undo() one step at a time. Both containers are deques
+// so pruning the oldest snapshots is cheap as well.
+class TimeIndexedCaretaker {
+public:
+    using TimePoint = std::chrono::system_clock::time_point;
+
+private:
+    std::deque<std::unique_ptr<IMemento>> mementos_;
+    std::deque<TimePoint> dates_;
+    Originator* originator_;
+
+    // Drops every snapshot from |index| onwards.
+    void TruncateFrom(std::size_t index) {
+        mementos_.erase(mementos_.begin() + index, mementos_.end());
+        dates_.erase(dates_.begin() + index, dates_.end());
+    }
+
+public:
+    TimeIndexedCaretaker(Originator* originator) : originator_(originator) {
+    }
+
+    // Snapshots |date|. The index must stay sorted, so a date earlier than
+    // the latest snapshot (the wall clock may step backwards) is recorded as
+    // that snapshot's date instead.
+    void Backup(TimePoint date = std::chrono::system_clock::now()) {
+        if (!dates_.empty() && date < dates_.back()) {
+            date = dates_.back();
+        }
+        mementos_.push_back(originator_->Save(date));
+        dates_.push_back(date);
+    }
+
+    void Undo() {
+        while (!mementos_.empty()) {
+            std::unique_ptr<IMemento> memento = std::move(mementos_.back());
+            mementos_.pop_back();
+            dates_.pop_back();
+            try {
+                originator_->Restore(memento.get());
+                return;
+            } catch (const std::runtime_error&) {
+            }
+        }
+    }
+
+    // Returns the latest snapshot taken at or before |when|, or nullptr if
+    // the history starts after it. O(log n).
+    const IMemento* SnapshotAt(TimePoint when) const {
+        std::deque<TimePoint>::const_iterator it = std::upper_bound(dates_.begin(), dates_.end(), when);
+        if (it == dates_.begin()) {
+            return nullptr;
+        }
+        return mementos_[(it - dates_.begin()) - 1].get();
+    }
+
+    // Rolls the originator back to the latest snapshot taken at or before
+    // |when|. Like a sequence of Undo() calls, the restored snapshot and
+    // everything newer are discarded. Returns the number of snapshots
+    // dropped, or 0 if there is nothing old enough to restore.
+    std::size_t RestoreTo(TimePoint when) {
+        std::size_t index = std::upper_bound(dates_.begin(), dates_.end(), when) - dates_.begin();
+        while (index > 0) {
+            --index;
+            try {
+                originator_->Restore(mementos_[index].get());
+            } catch (const std::runtime_error&) {
+                continue;
+            }
+            std::size_t dropped = mementos_.size() - index;
+            TruncateFrom(index);
+            return dropped;
+        }
+        return 0;
+    }
+
+    // Removes every snapshot taken strictly before |cutoff|. Returns the
+    // number of snapshots removed.
+    std::size_t PruneOlderThan(TimePoint cutoff) {
+        std::size_t count = std::lower_bound(dates_.begin(), dates_.end(), cutoff) - dates_.begin();
+        mementos_.erase(mementos_.begin(), mementos_.begin() + count);
+        dates_.erase(dates_.begin(), dates_.begin() + count);
+        return count;
+    }
+
+    std::size_t size() const {
+        return mementos_.size();
+    }
+
+    void ShowHistory() const {
+        std::cout << "Caretaker: Here's the list of mementos:" << std::endl;
+        for (const std::unique_ptr<IMemento>& memento : mementos_) {
+            std::cout << memento->GetName() << std::endl;
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    using std::chrono::hours;
+    using std::chrono::minutes;
+    using std::chrono::seconds;
+    using Clock = std::chrono::steady_clock;
+
+    // Client code: one snapshot every 10 minutes over an afternoon.
+    Originator originator("Initial state");
+    TimeIndexedCaretaker caretaker(&originator);
+    std::chrono::system_clock::time_point noon = std::chrono::system_clock::time_point(hours(24 * 365 * 50));
+    for (int i = 0; i < 12; ++i) {
+        originator.set_state("+" + std::to_string(i * 10) + "min state");
+        caretaker.Backup(noon + minutes(i * 10));
+    }
+    originator.set_state("Current state");
+    caretaker.ShowHistory();
+
+    std::cout << "\nClient: What did we have at +45min?" << std::endl;
+    std::cout << caretaker.SnapshotAt(noon + minutes(45))->GetName() << std::endl;
+
+    std::cout << "\nClient: Roll back to +45min in one step." << std::endl;
+    std::size_t dropped = caretaker.RestoreTo(noon + minutes(45));
+    std::cout << "Caretaker: dropped " << dropped << " snapshots, state is now: " << originator.state() << std::endl;
+
+    std::cout << "\nClient: Forget everything older than +20min." << std::endl;
+    std::size_t pruned = caretaker.PruneOlderThan(noon + minutes(20));
+    std::cout << "Caretaker: pruned " << pruned << " snapshots" << std::endl;
+    caretaker.ShowHistory();
+
+    // Benchmark: one snapshot per second, then roll back three hours.
+    // Rolling back 3 hours needs at least 3 hours and one second of history.
+    const std::size_t kMinCount = 3 * 3600 + 1;
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    count = std::max(count, kMinCount);
+    std::chrono::system_clock::time_point last = noon + seconds(count - 1);
+    std::chrono::system_clock::time_point target = last - hours(3);
+    std::cout << "\nBenchmark: " << count << " snapshots one second apart, rollback by 3 hours\n" << std::endl;
+
+    for (int round = 0; round < 2; ++round) {
+        Originator benchOriginator("x");
+        TimeIndexedCaretaker benchCaretaker(&benchOriginator);
+        for (std::size_t i = 0; i < count; ++i) {
+            benchOriginator.set_state("snapshot " + std::to_string(i));
+            benchCaretaker.Backup(noon + seconds(i));
+        }
+
+        Clock::time_point start = Clock::now();
+        std::size_t steps = 0;
+        if (round == 0) {
+            const IMemento* snapshot = benchCaretaker.SnapshotAt(target);
+            if (!snapshot) {
+                std::cout << "No snapshot at or before the target" << std::endl;
+                return 1;
+            }
+            std::string wanted = snapshot->GetState();
+            while (benchOriginator.state() != wanted) {
+                benchCaretaker.Undo();
+                ++steps;
+            }
+        } else {
+            steps = benchCaretaker.RestoreTo(target);
+        }
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        std::cout << (round == 0 ? "repeated Undo():" : "RestoreTo():    ") << " " << us << " us, "
+                  << steps << " snapshots unwound, state " << benchOriginator.state() << std::endl;
+
+        start = Clock::now();
+        pruned = benchCaretaker.PruneOlderThan(target - hours(1));
+        us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        std::cout << "PruneOlderThan(): " << us << " us, " << pruned << " snapshots removed, "
+                  << benchCaretaker.size() << " left" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,321 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <typeinfo>
+#include <memory>
+#include <string>
+
+// The Memento interface provides a way to retrieve the memento's metadata,
+// such as creation date or name. However, it doesn't expose the
+// Originator's state.
+class IMemento {
+public:
+    virtual std::string GetName() const = 0;
+    virtual std::string GetState() const = 0;
+    virtual std::chrono::system_clock::time_point GetDate() const = 0;
+    virtual ~IMemento() {}
+};
+
+class ConcreteMemento : public IMemento {
+private:
+    std::string state_;
+    std::chrono::system_clock::time_point date_;
+
+public:
+    ConcreteMemento(const std::string& state)
+        : state_(state), date_(std::chrono::system_clock::now()) {
+    }
+
+    std::string GetState() const override {
+        return state_;
+    }
+
+    std::string GetName() const override {
+        return std::to_string(date_.time_since_epoch().count()) + " / (" + state_.substr(0, 9) + ")...";
+    }
+
+    std::chrono::system_clock::time_point GetDate() const override {
+        return date_;
+    }
+};
+
+// xoshiro256** seeded through splitmix64: a few nanoseconds per 64-bit
+// value and the same sequence on every platform for a given seed.
+class FastRandom {
+public:
+    explicit FastRandom(std::uint64_t seed) {
+        for (std::uint64_t& word : s_) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            std::uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    std::uint64_t Next() {
+        std::uint64_t result = Rotl(s_[1] * 5, 7) * 9;
+        std::uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = Rotl(s_[3], 45);
+        return result;
+    }
+
+    // Value in [0, bound). Bounds up to 2^32 use Lemire's multiply-shift
+    // reduction on the top 32 bits, which fits in 64-bit arithmetic; larger
+    // bounds fall back to a modulo.
+    std::uint64_t Below(std::uint64_t bound) {
+        if (bound <= (std::uint64_t(1) << 32)) {
+            return ((Next() >> 32) * bound) >> 32;
+        }
+        return Next() % bound;
+    }
+
+private:
+    static std::uint64_t Rotl(std::uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    std::uint64_t s_[4];
+};
+
+// kInteractive keeps the original demo behaviour (rand() and a 12 ms pause
+// per character). kFast uses a seeded FastRandom, generates the state with no
+// pauses and mutates only a fraction of it on each DoSomething(), so the
+// Memento machinery itself becomes the bottleneck.
+enum class GeneratorMode { kInteractive, kFast };
+
+struct Workload {
+    GeneratorMode mode = GeneratorMode::kInteractive;
+    std::size_t state_size = 30;
+    double mutation_rate = 1.0;  // fraction of the state rewritten per DoSomething(), in [0, 1]
+    std::uint64_t seed = 42;
+};
+
+class Originator {
+private:
+    static constexpr char kAllowedSymbols[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    static constexpr std::size_t kSymbolCount = sizeof(kAllowedSymbols) - 1;
+
+    std::string state_;
+    Workload workload_;
+    FastRandom random_;
+    bool verbose_;
+
+public:
+    Originator(const std::string& state, const Workload& workload = Workload(), bool verbose = true)
+        : state_(state), workload_(workload), random_(workload.seed), verbose_(verbose) {
+        if (!(workload_.mutation_rate >= 0.0 && workload_.mutation_rate <= 1.0)) {
+            throw std::invalid_argument("Originator: mutation rate must be in [0, 1]");
+        }
+        if (workload_.mode == GeneratorMode::kFast) {
+            state_ = GenerateRandomString(workload_.state_size);
+        }
+        if (verbose_) {
+            std::cout << "Originator: My initial state is: " << state_.substr(0, 60) << std::endl;
+        }
+    }
+
+    const std::string& state() const {
+        return state_;
+    }
+
+    void DoSomething() {
+        if (verbose_) {
+            std::cout << "Originator: I'm doing something important." << std::endl;
+        }
+        if (workload_.mode == GeneratorMode::kInteractive || workload_.mutation_rate >= 1.0) {
+            state_ = GenerateRandomString(workload_.state_size);
+        } else {
+            Mutate();
+        }
+        if (verbose_) {
+            std::cout << "Originator: and my state has changed to: " << state_.substr(0, 60) << std::endl;
+        }
+    }
+
+    std::string GenerateRandomString(std::size_t length = 10) {
+        std::string result(length, '\0');
+        if (workload_.mode == GeneratorMode::kInteractive) {
+            for (char& c : result) {
+                c = kAllowedSymbols[rand() % kSymbolCount];
+                std::this_thread::sleep_for(std::chrono::milliseconds(12));
+            }
+            return result;
+        }
+
+        // Eight symbols per 64-bit draw; the 8-bit slices are mapped onto
+        // the alphabet with a multiply-shift. The slight bias does not matter
+        // for synthetic load.
+        std::size_t i = 0;
+        while (i < length) {
+            std::uint64_t bits = random_.Next();
+            for (int k = 0; k < 8 && i < length; ++k, ++i, bits >>= 8) {
+                result[i] = kAllowedSymbols[((bits & 0xff) * kSymbolCount) >> 8];
+            }
+        }
+        return result;
+    }
+
+    std::unique_ptr<IMemento> Save() {
+        return std::make_unique<ConcreteMemento>(state_);
+    }
+
+    void Restore(const IMemento* memento) {
+        const ConcreteMemento* concreteMemento = dynamic_cast<const ConcreteMemento*>(memento);
+        if (concreteMemento == nullptr) {
+            throw std::runtime_error("Unknown memento class " + std::string(typeid(*memento).name()));
+        }
+
+        state_ = concreteMemento->GetState();
+        if (verbose_) {
+            std::cout << "Originator: My state has changed to: " << state_.substr(0, 60) << std::endl;
+        }
+    }
+
+private:
+    // Rewrites mutation_rate * state_size randomly chosen characters (at
+    // least one).
+    void Mutate() {
+        if (state_.empty()) {
+            return;
+        }
+        std::size_t changes = static_cast<std::size_t>(workload_.mutation_rate * state_.size());
+        if (changes == 0) {
+            changes = 1;
+        }
+        for (std::size_t i = 0; i < changes; ++i) {
+            state_[random_.Below(state_.size())] = kAllowedSymbols[random_.Below(kSymbolCount)];
+        }
+    }
+};
+
+class Caretaker {
+private:
+    std::vector<std::unique_ptr<IMemento>> mementos_;
+    Originator* originator_;
+
+public:
+    Caretaker(Originator* originator) : originator_(originator) {
+    }
+
+    void Backup() {
+        mementos_.push_back(originator_->Save());
+    }
+
+    void Undo() {
+        while (!mementos_.empty()) {
+            std::unique_ptr<IMemento> memento = std::move(mementos_.back());
+            mementos_.pop_back();
+            try {
+                originator_->Restore(memento.get());
+                return;
+            } catch (const std::runtime_error&) {
+            }
+        }
+    }
+};
+
+std::uint64_t Fingerprint(const std::string& s) {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : s) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Runs |depth| rounds of DoSomething + Backup followed by |depth| Undo calls
+// and prints the rate of each operation.
+void RunBenchmark(std::size_t state_size, double mutation_rate, std::size_t byte_budget) {
+    using Clock = std::chrono::steady_clock;
+
+    Workload workload;
+    workload.mode = GeneratorMode::kFast;
+    workload.state_size = state_size;
+    workload.mutation_rate = mutation_rate;
+
+    std::size_t depth = std::max<std::size_t>(4, std::min<std::size_t>(100000, byte_budget / state_size));
+    Originator originator("", workload, false);
+    Caretaker caretaker(&originator);
+
+    Clock::duration backup(0);
+    Clock::duration work(0);
+    for (std::size_t i = 0; i < depth; ++i) {
+        Clock::time_point start = Clock::now();
+        caretaker.Backup();
+        Clock::time_point middle = Clock::now();
+        originator.DoSomething();
+        work += Clock::now() - middle;
+        backup += middle - start;
+    }
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < depth; ++i) {
+        caretaker.Undo();
+    }
+    Clock::duration undo = Clock::now() - start;
+
+    auto rate = [depth](Clock::duration d) {
+        return depth / std::chrono::duration<double>(d).count();
+    };
+    auto bandwidth = [depth, state_size](Clock::duration d) {
+        return depth * state_size / std::chrono::duration<double>(d).count() / (1 << 20);
+    };
+    std::cout << std::setw(10) << state_size << std::setw(8) << depth
+              << std::setw(14) << rate(backup) << std::setw(11) << bandwidth(backup)
+              << std::setw(14) << rate(work)
+              << std::setw(14) << rate(undo) << std::setw(11) << bandwidth(undo)
+              << "  " << std::hex << Fingerprint(originator.state()) << std::dec << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    // Client code: the same seed always produces the same history.
+    Workload workload;
+    workload.mode = GeneratorMode::kFast;
+    workload.mutation_rate = 0.1;
+    Originator* originator = new Originator("", workload);
+    Caretaker* caretaker = new Caretaker(originator);
+
+    caretaker->Backup();
+    originator->DoSomething();
+    caretaker->Backup();
+    originator->DoSomething();
+
+    std::cout << "\nClient: Now, let's rollback!\n" << std::endl;
+    caretaker->Undo();
+    caretaker->Undo();
+
+    delete caretaker;
+    delete originator;
+
+    // Benchmark: state sizes from 32 B to 64 MB, 10% of the state mutated per
+    // DoSomething() unless another rate is given on the command line.
+    double mutation_rate = argc > 1 ? std::atof(argv[1]) : 0.1;
+    if (!(mutation_rate >= 0.0 && mutation_rate <= 1.0)) {
+        std::cout << "The mutation rate must be between 0 and 1." << std::endl;
+        return 1;
+    }
+    std::size_t max_size = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::size_t(64) << 20;
+    std::size_t byte_budget = std::size_t(256) << 20;
+
+    std::cout << "\nBenchmark: mutation rate " << mutation_rate << "\n" << std::endl;
+    std::cout << std::setw(10) << "bytes" << std::setw(8) << "depth"
+              << std::setw(14) << "Backup/s" << std::setw(11) << "MB/s"
+              << std::setw(14) << "DoSomething/s"
+              << std::setw(14) << "Undo/s" << std::setw(11) << "MB/s"
+              << "  fingerprint" << std::endl;
+    for (std::size_t size = 32; size <= max_size; size *= 8) {
+        RunBenchmark(size, mutation_rate, byte_budget);
+    }
+
+    return 0;
+}
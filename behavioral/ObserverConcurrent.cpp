@@ -0,0 +1,367 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+class IObserver {
+public:
+  virtual ~IObserver() {}
+  virtual void Update(const std::string& message_from_subject) = 0;
+};
+
+/**
+ * EpochDomain is a small epoch-based reclamation scheme shared by all
+ * concurrent subjects. A reader announces the global epoch in its own slot
+ * before it touches a snapshot and clears the slot afterwards. A writer that
+ * replaces a snapshot tags the old one with the epoch at which it was
+ * unlinked; the old snapshot may be freed once every announced epoch is newer
+ * than that tag, because no reader can still be looking at it.
+ *
+ * Readers never block and never write shared cache lines other than their own
+ * slot, which is what keeps Notify() lock-free.
+ */
+class EpochDomain {
+public:
+  static constexpr std::size_t kMaxReaders = 64;
+  static constexpr std::uint64_t kQuiescent = 0;
+
+  static EpochDomain& Instance() {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  // RAII guard for a read-side critical section. Guards nest, only the
+  // outermost one announces.
+  class ReadGuard {
+  public:
+    ReadGuard() {
+      ThreadState& state = Local();
+      if (state.depth++ == 0) {
+        EpochDomain& domain = Instance();
+        state.slot->epoch.store(domain.epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+      }
+    }
+
+    ~ReadGuard() {
+      ThreadState& state = Local();
+      if (--state.depth == 0) {
+        state.slot->epoch.store(kQuiescent, std::memory_order_release);
+      }
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+  };
+
+  // Advances the global epoch and returns the epoch the caller's retired
+  // object has to be tagged with.
+  std::uint64_t Retire() {
+    return epoch_.fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  // Oldest epoch any reader may still be running in; objects retired before
+  // it are safe to free.
+  std::uint64_t SafeEpoch() const {
+    std::uint64_t oldest = epoch_.load(std::memory_order_seq_cst);
+    for (const Slot& slot : slots_) {
+      std::uint64_t announced = slot.epoch.load(std::memory_order_seq_cst);
+      if (announced != kQuiescent && announced < oldest) {
+        oldest = announced;
+      }
+    }
+    return oldest;
+  }
+
+private:
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> epoch{kQuiescent};
+    std::atomic<bool> in_use{false};
+  };
+
+  // Each thread claims a slot on its first read and gives it back on exit.
+  struct ThreadState {
+    Slot* slot = nullptr;
+    int depth = 0;
+
+    ThreadState() {
+      for (Slot& candidate : Instance().slots_) {
+        bool expected = false;
+        if (candidate.in_use.compare_exchange_strong(expected, true)) {
+          slot = &candidate;
+          return;
+        }
+      }
+      std::cerr << "EpochDomain: more than " << kMaxReaders << " reader threads\n";
+      std::abort();
+    }
+
+    ~ThreadState() {
+      slot->epoch.store(kQuiescent, std::memory_order_release);
+      slot->in_use.store(false, std::memory_order_release);
+    }
+  };
+
+  static ThreadState& Local() {
+    thread_local ThreadState state;
+    return state;
+  }
+
+  EpochDomain() = default;
+
+  std::atomic<std::uint64_t> epoch_{1};
+  Slot slots_[kMaxReaders];
+};
+
+/**
+ * ConcurrentSubject publishes its observers as an immutable snapshot. Notify()
+ * reads the current snapshot inside an epoch guard and iterates it without
+ * taking any lock, so it can run on a producer thread while Attach() and
+ * Detach() are called from other threads. Writers serialize on a mutex, copy
+ * the snapshot, publish the copy and retire the old one for deferred
+ * reclamation.
+ *
+ * An observer detached while a Notify() is in flight may still receive that
+ * one last message; the snapshot keeps it alive until then.
+ */
+class ConcurrentSubject {
+public:
+  using Snapshot = std::vector<std::shared_ptr<IObserver>>;
+
+  ConcurrentSubject() : snapshot_(new Snapshot()) {
+  }
+
+  virtual ~ConcurrentSubject() {
+    // No reader may be running when the subject dies.
+    delete snapshot_.load(std::memory_order_relaxed);
+    for (const Retired& retired : retired_) {
+      delete retired.snapshot;
+    }
+  }
+
+  void Attach(std::shared_ptr<IObserver> observer) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    Snapshot* next = new Snapshot(*snapshot_.load(std::memory_order_relaxed));
+    next->push_back(std::move(observer));
+    Publish(next);
+  }
+
+  void Detach(const std::shared_ptr<IObserver>& observer) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    const Snapshot* current = snapshot_.load(std::memory_order_relaxed);
+    if (std::find(current->begin(), current->end(), observer) == current->end()) {
+      return;
+    }
+    Snapshot* next = new Snapshot();
+    next->reserve(current->size() - 1);
+    for (const std::shared_ptr<IObserver>& candidate : *current) {
+      if (candidate != observer) {
+        next->push_back(candidate);
+      }
+    }
+    Publish(next);
+  }
+
+  void Notify(const std::string& message) const {
+    EpochDomain::ReadGuard guard;
+    const Snapshot* observers = snapshot_.load(std::memory_order_seq_cst);
+    for (const std::shared_ptr<IObserver>& observer : *observers) {
+      observer->Update(message);
+    }
+  }
+
+  void CreateMessage(const std::string& message = "Empty") const {
+    Notify(message);
+  }
+
+  std::size_t HowManyObserver() const {
+    EpochDomain::ReadGuard guard;
+    return snapshot_.load(std::memory_order_seq_cst)->size();
+  }
+
+  // Frees retired snapshots that no reader can see any more. Called after
+  // every write; may also be called periodically.
+  std::size_t Reclaim() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    return ReclaimLocked();
+  }
+
+  std::size_t pending() const {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    return retired_.size();
+  }
+
+  std::size_t reclaimed() const {
+    return reclaimed_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Retired {
+    Snapshot* snapshot;
+    std::uint64_t epoch;
+  };
+
+  void Publish(Snapshot* next) {
+    Snapshot* previous = snapshot_.exchange(next, std::memory_order_seq_cst);
+    retired_.push_back(Retired{previous, EpochDomain::Instance().Retire()});
+    ReclaimLocked();
+  }
+
+  std::size_t ReclaimLocked() {
+    std::uint64_t safe = EpochDomain::Instance().SafeEpoch();
+    std::vector<Retired>::iterator keep = std::partition(retired_.begin(), retired_.end(),
+        [safe](const Retired& retired) { return retired.epoch >= safe; });
+    std::size_t freed = retired_.end() - keep;
+    for (std::vector<Retired>::iterator it = keep; it != retired_.end(); ++it) {
+      delete it->snapshot;
+    }
+    retired_.erase(keep, retired_.end());
+    reclaimed_.fetch_add(freed, std::memory_order_relaxed);
+    return freed;
+  }
+
+  std::atomic<Snapshot*> snapshot_;
+  mutable std::mutex writer_mutex_;
+  std::vector<Retired> retired_;
+  std::atomic<std::size_t> reclaimed_{0};
+};
+
+class Observer : public IObserver {
+public:
+  Observer(int number) : number_(number) {
+  }
+
+  void Update(const std::string& message_from_subject) override {
+    std::cout << "Observer \"" << number_ << "\": a new message is available --> " << message_from_subject << "\n";
+  }
+
+private:
+  int number_;
+};
+
+void ClientCode() {
+  ConcurrentSubject subject;
+  std::shared_ptr<Observer> observer1 = std::make_shared<Observer>(1);
+  std::shared_ptr<Observer> observer2 = std::make_shared<Observer>(2);
+  std::shared_ptr<Observer> observer3 = std::make_shared<Observer>(3);
+
+  subject.Attach(observer1);
+  subject.Attach(observer2);
+  subject.Attach(observer3);
+  subject.Detach(observer1);
+
+  std::cout << "There are " << subject.HowManyObserver() << " observers in the list.\n";
+  subject.CreateMessage("Hello there!");
+
+  subject.Detach(observer2);
+  std::cout << "There are " << subject.HowManyObserver() << " observers in the list.\n";
+  subject.CreateMessage("change message message");
+}
+
+class CountingObserver : public IObserver {
+public:
+  void Update(const std::string& message_from_subject) override {
+    length_.fetch_add(message_from_subject.size(), std::memory_order_relaxed);
+    updates_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::size_t updates() const {
+    return updates_.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<std::size_t> length_{0};
+  std::atomic<std::size_t> updates_{0};
+};
+
+/**
+ * Stress benchmark: one producer notifies as fast as it can while churn
+ * threads keep attaching and detaching observers.
+ */
+void Benchmark(std::size_t base_observers, std::size_t churn_threads, std::chrono::milliseconds duration) {
+  ConcurrentSubject subject;
+  std::vector<std::shared_ptr<CountingObserver>> resident;
+  for (std::size_t i = 0; i < base_observers; ++i) {
+    resident.push_back(std::make_shared<CountingObserver>());
+    subject.Attach(resident.back());
+  }
+
+  std::atomic<bool> stop{false};
+  std::atomic<std::size_t> notifications{0};
+  std::atomic<std::size_t> writes{0};
+
+  std::thread producer([&]() {
+    const std::string message = "tick";
+    std::size_t local = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      subject.Notify(message);
+      ++local;
+    }
+    notifications.store(local);
+  });
+
+  std::vector<std::thread> churners;
+  for (std::size_t t = 0; t < churn_threads; ++t) {
+    churners.emplace_back([&, t]() {
+      std::mt19937 rng(static_cast<unsigned>(t + 1));
+      std::vector<std::shared_ptr<CountingObserver>> mine;
+      std::size_t local = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (mine.size() < 8 && (mine.empty() || rng() % 2 == 0)) {
+          mine.push_back(std::make_shared<CountingObserver>());
+          subject.Attach(mine.back());
+        } else {
+          std::size_t victim = rng() % mine.size();
+          subject.Detach(mine[victim]);
+          mine.erase(mine.begin() + victim);
+        }
+        ++local;
+      }
+      for (const std::shared_ptr<CountingObserver>& observer : mine) {
+        subject.Detach(observer);
+      }
+      writes.fetch_add(local);
+    });
+  }
+
+  std::this_thread::sleep_for(duration);
+  stop.store(true);
+  producer.join();
+  for (std::thread& churner : churners) {
+    churner.join();
+  }
+  subject.Reclaim();
+
+  std::size_t delivered = 0;
+  for (const std::shared_ptr<CountingObserver>& observer : resident) {
+    delivered += observer->updates();
+  }
+  double seconds = std::chrono::duration<double>(duration).count();
+  std::cout << "  " << base_observers << " resident observers, " << churn_threads << " churn threads: "
+            << notifications.load() / seconds << " Notify/s, "
+            << delivered / seconds << " resident updates/s, "
+            << writes.load() / seconds << " attach+detach/s, "
+            << subject.reclaimed() << " snapshots reclaimed, "
+            << subject.pending() << " pending\n";
+  if (delivered != notifications.load() * base_observers) {
+    std::cout << "  ERROR: resident observers missed notifications\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  ClientCode();
+
+  std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 1000);
+  std::cout << "\nBenchmark: concurrent churn for " << duration.count() << " ms per run\n";
+  for (std::size_t churn_threads : {std::size_t(0), std::size_t(1), std::size_t(4)}) {
+    Benchmark(100, churn_threads, duration);
+  }
+  return 0;
+}
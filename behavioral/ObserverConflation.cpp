@@ -0,0 +1,376 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class IObserver {
+public:
+  virtual ~IObserver() {}
+  virtual void Update(const std::string& topic, const std::string& message_from_subject) = 0;
+};
+
+/**
+ * kEveryMessage calls the observer synchronously for each message, exactly
+ * like Subject::Notify in Observer.cpp. kConflate puts a mailbox with its own
+ * thread in front of the observer; while the observer is busy, newer values
+ * for a topic replace older undelivered ones, so it only ever sees the latest
+ * value per topic.
+ */
+enum class DeliveryMode { kEveryMessage, kConflate };
+
+struct ConflationStats {
+  std::size_t received = 0;
+  std::size_t delivered = 0;
+  std::size_t conflated = 0;  // messages replaced before delivery
+  double mean_latency_us = 0;
+  double p99_latency_us = 0;
+  double max_latency_us = 0;
+};
+
+/**
+ * ConflatingMailbox is itself an observer: it accepts messages on the
+ * publishing thread, keeps one pending value per topic and delivers them to
+ * the wrapped observer from a worker thread in first-come order. The
+ * destructor delivers whatever is still pending before it stops the worker.
+ */
+class ConflatingMailbox : public IObserver {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit ConflatingMailbox(std::shared_ptr<IObserver> observer)
+      : observer_(std::move(observer)), worker_(&ConflatingMailbox::Run, this) {
+  }
+
+  virtual ~ConflatingMailbox() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    ready_.notify_one();
+    worker_.join();
+  }
+
+  const std::shared_ptr<IObserver>& observer() const {
+    return observer_;
+  }
+
+  void Update(const std::string& topic, const std::string& message_from_subject) override {
+    Clock::time_point now = Clock::now();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++received_;
+      std::unordered_map<std::string, Pending>::iterator it = pending_.find(topic);
+      if (it != pending_.end()) {
+        it->second.message = message_from_subject;
+        it->second.published = now;
+        ++conflated_;
+        return;
+      }
+      pending_.emplace(topic, Pending{message_from_subject, now});
+      order_.push_back(topic);
+    }
+    ready_.notify_one();
+  }
+
+  // Waits until everything received so far has been delivered.
+  void Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return order_.empty() && !busy_; });
+  }
+
+  ConflationStats Stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ConflationStats stats;
+    stats.received = received_;
+    stats.delivered = latencies_us_.size();
+    stats.conflated = conflated_;
+    if (!latencies_us_.empty()) {
+      std::vector<double> sorted = latencies_us_;
+      std::sort(sorted.begin(), sorted.end());
+      double total = 0;
+      for (double latency : sorted) {
+        total += latency;
+      }
+      stats.mean_latency_us = total / sorted.size();
+      stats.p99_latency_us = sorted[(sorted.size() - 1) * 99 / 100];
+      stats.max_latency_us = sorted.back();
+    }
+    return stats;
+  }
+
+private:
+  struct Pending {
+    std::string message;
+    Clock::time_point published;
+  };
+
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      ready_.wait(lock, [this]() { return !order_.empty() || stop_; });
+      if (order_.empty()) {
+        return;
+      }
+      std::string topic = std::move(order_.front());
+      order_.pop_front();
+      std::unordered_map<std::string, Pending>::iterator it = pending_.find(topic);
+      Pending pending = std::move(it->second);
+      pending_.erase(it);
+      busy_ = true;
+
+      lock.unlock();
+      observer_->Update(topic, pending.message);
+      double latency = std::chrono::duration<double, std::micro>(Clock::now() - pending.published).count();
+      lock.lock();
+
+      latencies_us_.push_back(latency);
+      busy_ = false;
+      if (order_.empty()) {
+        idle_.notify_all();
+      }
+    }
+  }
+
+  std::shared_ptr<IObserver> observer_;
+  mutable std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable idle_;
+  std::unordered_map<std::string, Pending> pending_;
+  std::deque<std::string> order_;
+  std::vector<double> latencies_us_;
+  std::size_t received_ = 0;
+  std::size_t conflated_ = 0;
+  bool busy_ = false;
+  bool stop_ = false;
+  std::thread worker_;
+};
+
+/**
+ * TopicSubject keeps one observer list per topic, so CreateMessage() only
+ * reaches the observers that subscribed to that topic. An observer attached
+ * with kConflate gets a single mailbox shared by all of its topics, so it is
+ * never called from two threads at once. For the same reason an observer uses
+ * one delivery mode for all of its topics; Attach() rejects mixing them.
+ */
+class TopicSubject {
+public:
+  virtual ~TopicSubject() {
+    std::cout << "Goodbye, I was the Subject.\n";
+  }
+
+  // Returns the observer's mailbox for kConflate subscriptions so the caller
+  // can flush it and read its statistics; returns nullptr for kEveryMessage.
+  // Attaching an observer to a topic twice has no further effect. Throws
+  // std::invalid_argument if the observer is already attached in the other
+  // mode.
+  std::shared_ptr<ConflatingMailbox> Attach(const std::string& topic, std::shared_ptr<IObserver> observer,
+                                            DeliveryMode mode = DeliveryMode::kEveryMessage) {
+    std::unordered_map<IObserver*, std::shared_ptr<ConflatingMailbox>>::iterator existing = mailboxes_.find(observer.get());
+    bool conflated = existing != mailboxes_.end();
+    if (conflated != (mode == DeliveryMode::kConflate) && (conflated || IsSubscribed(observer.get()))) {
+      throw std::invalid_argument("TopicSubject: an observer cannot mix delivery modes");
+    }
+
+    std::shared_ptr<ConflatingMailbox> mailbox;
+    if (mode == DeliveryMode::kConflate) {
+      mailbox = conflated ? existing->second : std::make_shared<ConflatingMailbox>(observer);
+      mailboxes_[observer.get()] = mailbox;
+      observer = mailbox;
+    }
+    std::vector<std::shared_ptr<IObserver>>& list = topics_[topic];
+    if (std::find(list.begin(), list.end(), observer) == list.end()) {
+      list.push_back(observer);
+    }
+    return mailbox;
+  }
+
+  void Detach(const std::string& topic, const std::shared_ptr<IObserver>& observer) {
+    std::unordered_map<std::string, std::vector<std::shared_ptr<IObserver>>>::iterator it = topics_.find(topic);
+    if (it == topics_.end()) {
+      return;
+    }
+    // The observer is on the topic either directly or through its mailbox.
+    std::unordered_map<IObserver*, std::shared_ptr<ConflatingMailbox>>::iterator mailbox = mailboxes_.find(observer.get());
+    IObserver* direct = observer.get();
+    IObserver* conflated = mailbox != mailboxes_.end() ? mailbox->second.get() : nullptr;
+
+    std::vector<std::shared_ptr<IObserver>>& list = it->second;
+    list.erase(std::remove_if(list.begin(), list.end(), [direct, conflated](const std::shared_ptr<IObserver>& candidate) {
+      return candidate.get() == direct || candidate.get() == conflated;
+    }), list.end());
+    if (list.empty()) {
+      topics_.erase(it);
+    }
+
+    // Retire the mailbox once it has no topic left.
+    if (conflated && !IsSubscribed(conflated)) {
+      mailboxes_.erase(mailbox);
+    }
+  }
+
+  void Notify(const std::string& topic, const std::string& message) {
+    std::unordered_map<std::string, std::vector<std::shared_ptr<IObserver>>>::iterator it = topics_.find(topic);
+    if (it == topics_.end()) {
+      return;
+    }
+    for (const std::shared_ptr<IObserver>& observer : it->second) {
+      observer->Update(topic, message);
+    }
+  }
+
+  void CreateMessage(const std::string& topic, std::string message = "Empty") {
+    Notify(topic, message);
+  }
+
+private:
+  bool IsSubscribed(const IObserver* observer) const {
+    for (const auto& topic : topics_) {
+      for (const std::shared_ptr<IObserver>& candidate : topic.second) {
+        if (candidate.get() == observer) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  std::unordered_map<std::string, std::vector<std::shared_ptr<IObserver>>> topics_;
+  std::unordered_map<IObserver*, std::shared_ptr<ConflatingMailbox>> mailboxes_;
+};
+
+class Observer : public IObserver {
+public:
+  Observer(int number, std::chrono::microseconds cost = std::chrono::microseconds(0), bool verbose = true)
+      : number_(number), cost_(cost), verbose_(verbose) {
+  }
+
+  void Update(const std::string& topic, const std::string& message_from_subject) override {
+    message_from_subject_ = message_from_subject;
+    ++updates_;
+    if (cost_.count() > 0) {
+      std::this_thread::sleep_for(cost_);
+    }
+    if (verbose_) {
+      std::cout << "Observer \"" << number_ << "\": a new message on " << topic << " --> " << message_from_subject_ << "\n";
+    }
+  }
+
+  std::size_t updates() const {
+    return updates_.load();
+  }
+
+private:
+  std::string message_from_subject_;
+  int number_;
+  std::chrono::microseconds cost_;
+  bool verbose_;
+  std::atomic<std::size_t> updates_{0};
+};
+
+void ClientCode() {
+  TopicSubject subject;
+  std::shared_ptr<Observer> observer1 = std::make_shared<Observer>(1);
+  std::shared_ptr<Observer> observer2 = std::make_shared<Observer>(2, std::chrono::microseconds(20000));
+
+  subject.Attach("prices", observer1);
+  subject.Attach("news", observer1);
+  std::shared_ptr<ConflatingMailbox> mailbox = subject.Attach("prices", observer2, DeliveryMode::kConflate);
+
+  subject.CreateMessage("news", "Hello there!");
+  for (int i = 1; i <= 5; ++i) {
+    subject.CreateMessage("prices", "price " + std::to_string(100 + i));
+  }
+  mailbox->Flush();
+  ConflationStats stats = mailbox->Stats();
+  std::cout << "Observer \"2\" received " << stats.received << " prices, " << stats.conflated << " were conflated.\n";
+
+  subject.Detach("prices", observer2);
+  subject.CreateMessage("prices", "price 200");
+
+  // An observer keeps one delivery mode, and attaching twice is a no-op.
+  std::shared_ptr<Observer> observer3 = std::make_shared<Observer>(3, std::chrono::microseconds(0), false);
+  std::shared_ptr<ConflatingMailbox> mailbox3 = subject.Attach("prices", observer3, DeliveryMode::kConflate);
+  subject.Attach("prices", observer3, DeliveryMode::kConflate);
+  try {
+    subject.Attach("news", observer3);
+  } catch (const std::invalid_argument& error) {
+    std::cout << "Observer \"3\": " << error.what() << "\n";
+  }
+  subject.CreateMessage("news", "direct 1");
+  subject.CreateMessage("prices", "price 300");
+  mailbox3->Flush();
+  std::size_t delivered = observer3->updates();
+  subject.Detach("prices", observer3);
+  subject.CreateMessage("prices", "price 301");
+  mailbox3->Flush();
+  bool ok = delivered == 1 && observer3->updates() == 1;
+  std::cout << "Observer \"3\" received " << observer3->updates() << " update(s)" << (ok ? "" : " (mismatch!)")
+            << "\n";
+}
+
+/**
+ * Benchmark: a producer publishes round-robin over 16 topics. A fast observer
+ * listens to everything, a slow one (50 us per update) to four topics. The
+ * slow observer is first attached synchronously, then with conflation.
+ */
+void Benchmark(std::size_t messages) {
+  using Clock = std::chrono::steady_clock;
+  const std::size_t kTopics = 16;
+  std::vector<std::string> topics;
+  for (std::size_t t = 0; t < kTopics; ++t) {
+    topics.push_back("topic" + std::to_string(t));
+  }
+
+  for (DeliveryMode mode : {DeliveryMode::kEveryMessage, DeliveryMode::kConflate}) {
+    TopicSubject subject;
+    std::shared_ptr<Observer> fast = std::make_shared<Observer>(1, std::chrono::microseconds(0), false);
+    std::shared_ptr<Observer> slow = std::make_shared<Observer>(2, std::chrono::microseconds(50), false);
+    std::shared_ptr<ConflatingMailbox> mailbox;
+    for (std::size_t t = 0; t < kTopics; ++t) {
+      subject.Attach(topics[t], fast);
+      if (t % 4 == 0) {
+        mailbox = subject.Attach(topics[t], slow, mode);
+      }
+    }
+
+    Clock::time_point start = Clock::now();
+    for (std::size_t m = 0; m < messages; ++m) {
+      subject.CreateMessage(topics[m % kTopics], "value " + std::to_string(m));
+    }
+    double produce_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (mailbox) {
+      mailbox->Flush();
+    }
+    double total_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << (mode == DeliveryMode::kEveryMessage ? "  every message" : "  conflate     ")
+              << ": producer " << produce_ms << " ms (" << messages / produce_ms * 1000 << " msg/s), done after "
+              << total_ms << " ms | fast observer " << fast->updates() << " updates, slow observer "
+              << slow->updates() << " updates\n";
+    if (mailbox) {
+      ConflationStats stats = mailbox->Stats();
+      std::cout << "    slow mailbox: received " << stats.received << ", delivered " << stats.delivered
+                << ", conflated " << stats.conflated << ", end-to-end latency mean " << stats.mean_latency_us
+                << " us, p99 " << stats.p99_latency_us << " us, max " << stats.max_latency_us << " us\n";
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  ClientCode();
+
+  std::size_t messages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+  std::cout << "\nBenchmark: " << messages << " messages over 16 topics\n";
+  Benchmark(messages);
+  return 0;
+}
@@ -0,0 +1,468 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class IObserver {
+public:
+  virtual ~IObserver() {}
+  virtual void Update(const std::string& message_from_subject) = 0;
+};
+
+/**
+ * What Notify() does when an observer's queue is full:
+ *  - kBlock:      wait until the observer catches up (backpressure on the
+ *                 producer).
+ *  - kDropOldest: discard the oldest queued message to make room.
+ *  - kConflate:   overwrite the newest queued message, so a slow observer
+ *                 skips intermediate values but always sees the latest one.
+ */
+enum class OverflowPolicy { kBlock, kDropOldest, kConflate };
+
+struct ObserverMetrics {
+  std::size_t published = 0;  // messages offered to the observer
+  std::size_t delivered = 0;  // Update() calls completed
+  std::size_t dropped = 0;    // lost to kDropOldest
+  std::size_t conflated = 0;  // overwritten by kConflate
+  std::size_t lag = 0;        // messages currently queued
+  std::size_t max_lag = 0;
+  double max_latency_us = 0;  // enqueue to end of Update()
+};
+
+/**
+ * Partition is the unit of work of one worker thread: a set of subscriptions
+ * and a count of the messages queued across them.
+ */
+class Subscription;
+
+struct Partition {
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::condition_variable idle;
+  std::vector<std::shared_ptr<Subscription>> subscriptions;
+  std::size_t pending = 0;
+  std::size_t cursor = 0;
+  bool busy = false;
+  bool stop = false;
+  std::thread worker;
+};
+
+/**
+ * A Subscription is one observer plus its bounded ring buffer of messages.
+ * The producer pushes into it, the partition's worker pops from it.
+ */
+class Subscription {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Envelope {
+    std::string message;
+    Clock::time_point enqueued;
+  };
+
+  Subscription(std::shared_ptr<IObserver> observer, std::size_t capacity, OverflowPolicy policy, Partition* partition)
+      : observer_(std::move(observer)), ring_(std::max<std::size_t>(capacity, 1)), policy_(policy), partition_(partition) {
+  }
+
+  const std::shared_ptr<IObserver>& observer() const {
+    return observer_;
+  }
+
+  Partition* partition() const {
+    return partition_;
+  }
+
+  enum class PushResult { kQueued, kReplaced, kFull };
+
+  // Never waits. Returns kQueued if the queue grew by one message, kReplaced
+  // if the message replaced another one according to the overflow policy,
+  // and kFull if the policy is kBlock and the queue is full; in that case
+  // nothing was published and the caller may WaitForSpace() and retry.
+  PushResult TryPush(const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (size_ == ring_.size() && policy_ == OverflowPolicy::kBlock) {
+      return PushResult::kFull;
+    }
+    ++metrics_.published;
+    if (size_ == ring_.size()) {
+      switch (policy_) {
+        case OverflowPolicy::kBlock:
+          break;
+        case OverflowPolicy::kDropOldest:
+          ++metrics_.dropped;
+          ring_[head_] = Envelope{message, Clock::now()};
+          head_ = (head_ + 1) % ring_.size();
+          return PushResult::kReplaced;
+        case OverflowPolicy::kConflate:
+          ++metrics_.conflated;
+          ring_[(head_ + size_ - 1) % ring_.size()] = Envelope{message, Clock::now()};
+          return PushResult::kReplaced;
+      }
+    }
+    ring_[(head_ + size_) % ring_.size()] = Envelope{message, Clock::now()};
+    ++size_;
+    metrics_.max_lag = std::max(metrics_.max_lag, size_);
+    return PushResult::kQueued;
+  }
+
+  // Waits until the queue has room or the subscription is closed.
+  void WaitForSpace() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this]() { return size_ < ring_.size() || closed_; });
+  }
+
+  // Called on Detach(); releases a producer blocked in WaitForSpace().
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    not_full_.notify_all();
+  }
+
+  bool closed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closed_;
+  }
+
+  bool Pop(Envelope& envelope) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (size_ == 0) {
+        return false;
+      }
+      envelope = std::move(ring_[head_]);
+      head_ = (head_ + 1) % ring_.size();
+      --size_;
+    }
+    not_full_.notify_one();
+    return true;
+  }
+
+  void Deliver(const Envelope& envelope) {
+    observer_->Update(envelope.message);
+    double latency = std::chrono::duration<double, std::micro>(Clock::now() - envelope.enqueued).count();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++metrics_.delivered;
+    metrics_.max_latency_us = std::max(metrics_.max_latency_us, latency);
+  }
+
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+  ObserverMetrics Metrics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ObserverMetrics metrics = metrics_;
+    metrics.lag = size_;
+    return metrics;
+  }
+
+private:
+  std::shared_ptr<IObserver> observer_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::vector<Envelope> ring_;
+  std::size_t head_ = 0;
+  std::size_t size_ = 0;
+  OverflowPolicy policy_;
+  Partition* partition_;
+  ObserverMetrics metrics_;
+  bool closed_ = false;
+};
+
+/**
+ * FanOutSubject spreads its observers over a fixed pool of workers. Notify()
+ * only enqueues the message for every observer; each worker then delivers to
+ * the observers of its partition in round-robin order, one message at a time,
+ * so a slow observer holds back its own partition at most and never the
+ * producer (unless the policy is kBlock).
+ */
+class FanOutSubject {
+public:
+  FanOutSubject(std::size_t workers, std::size_t queue_capacity, OverflowPolicy policy)
+      : partitions_(std::max<std::size_t>(workers, 1)), queue_capacity_(queue_capacity), policy_(policy) {
+    for (Partition& partition : partitions_) {
+      partition.worker = std::thread(&FanOutSubject::Run, &partition);
+    }
+  }
+
+  virtual ~FanOutSubject() {
+    for (Partition& partition : partitions_) {
+      {
+        std::lock_guard<std::mutex> lock(partition.mutex);
+        partition.stop = true;
+      }
+      partition.ready.notify_one();
+      partition.worker.join();
+    }
+  }
+
+  void Attach(std::shared_ptr<IObserver> observer) {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex_);
+    Partition* target = &partitions_[0];
+    for (Partition& partition : partitions_) {
+      std::lock_guard<std::mutex> lock(partition.mutex);
+      if (partition.subscriptions.size() < target->subscriptions.size()) {
+        target = &partition;
+      }
+    }
+    std::shared_ptr<Subscription> subscription =
+        std::make_shared<Subscription>(std::move(observer), queue_capacity_, policy_, target);
+    {
+      std::lock_guard<std::mutex> lock(target->mutex);
+      target->subscriptions.push_back(subscription);
+    }
+    subscriptions_.push_back(subscription);
+  }
+
+  void Detach(const std::shared_ptr<IObserver>& observer) {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex_);
+    for (std::size_t i = 0; i < subscriptions_.size(); ++i) {
+      if (subscriptions_[i]->observer() != observer) {
+        continue;
+      }
+      std::shared_ptr<Subscription> subscription = subscriptions_[i];
+      subscriptions_.erase(subscriptions_.begin() + i);
+      subscription->Close();
+
+      Partition* partition = subscription->partition();
+      std::lock_guard<std::mutex> lock(partition->mutex);
+      std::vector<std::shared_ptr<Subscription>>& list = partition->subscriptions;
+      list.erase(std::find(list.begin(), list.end(), subscription));
+      partition->pending -= subscription->size();
+      partition->cursor = 0;
+      if (partition->pending == 0 && !partition->busy) {
+        partition->idle.notify_all();
+      }
+      return;
+    }
+  }
+
+  // Pushes happen under the registry lock so they cannot interleave with a
+  // Detach(). A kBlock subscription with a full queue is waited for with the
+  // lock released, so a slow observer stalls only the producer, not
+  // Detach() or Metrics().
+  void Notify() {
+    std::unique_lock<std::mutex> registry_lock(registry_mutex_);
+    std::string message = message_;
+    std::vector<std::shared_ptr<Subscription>> subscriptions = subscriptions_;
+    for (const std::shared_ptr<Subscription>& subscription : subscriptions) {
+      Subscription::PushResult result = Subscription::PushResult::kFull;
+      while (!subscription->closed() && (result = subscription->TryPush(message)) == Subscription::PushResult::kFull) {
+        registry_lock.unlock();
+        subscription->WaitForSpace();
+        registry_lock.lock();
+      }
+      if (result != Subscription::PushResult::kQueued) {
+        continue;
+      }
+      Partition* partition = subscription->partition();
+      {
+        std::lock_guard<std::mutex> lock(partition->mutex);
+        ++partition->pending;
+      }
+      partition->ready.notify_one();
+    }
+  }
+
+  void CreateMessage(std::string message = "Empty") {
+    this->message_ = message;
+    Notify();
+  }
+
+  // Waits until every queued message has been delivered.
+  void Drain() {
+    for (Partition& partition : partitions_) {
+      std::unique_lock<std::mutex> lock(partition.mutex);
+      partition.idle.wait(lock, [&partition]() { return partition.pending == 0 && !partition.busy; });
+    }
+  }
+
+  std::vector<ObserverMetrics> Metrics() const {
+    std::lock_guard<std::mutex> registry_lock(registry_mutex_);
+    std::vector<ObserverMetrics> metrics;
+    for (const std::shared_ptr<Subscription>& subscription : subscriptions_) {
+      metrics.push_back(subscription->Metrics());
+    }
+    return metrics;
+  }
+
+private:
+  static void Run(Partition* partition) {
+    Subscription::Envelope envelope;
+    std::unique_lock<std::mutex> lock(partition->mutex);
+    for (;;) {
+      partition->ready.wait(lock, [partition]() { return partition->pending > 0 || partition->stop; });
+      if (partition->stop) {
+        return;
+      }
+
+      std::shared_ptr<Subscription> next;
+      std::size_t count = partition->subscriptions.size();
+      for (std::size_t i = 0; i < count; ++i) {
+        std::shared_ptr<Subscription>& candidate = partition->subscriptions[(partition->cursor + i) % count];
+        if (candidate->Pop(envelope)) {
+          next = candidate;
+          partition->cursor = (partition->cursor + i + 1) % count;
+          break;
+        }
+      }
+      if (!next) {
+        continue;
+      }
+      --partition->pending;
+      partition->busy = true;
+
+      lock.unlock();
+      next->Deliver(envelope);
+      lock.lock();
+
+      partition->busy = false;
+      if (partition->pending == 0) {
+        partition->idle.notify_all();
+      }
+    }
+  }
+
+  std::vector<Partition> partitions_;
+  std::size_t queue_capacity_;
+  OverflowPolicy policy_;
+  mutable std::mutex registry_mutex_;
+  std::vector<std::shared_ptr<Subscription>> subscriptions_;
+  std::string message_;
+};
+
+class Observer : public IObserver {
+public:
+  Observer(int number, std::chrono::microseconds cost = std::chrono::microseconds(0), bool verbose = true)
+      : number_(number), cost_(cost), verbose_(verbose) {
+  }
+
+  void Update(const std::string& message_from_subject) override {
+    message_from_subject_ = message_from_subject;
+    if (cost_.count() > 0) {
+      std::this_thread::sleep_for(cost_);
+    }
+    if (verbose_) {
+      std::lock_guard<std::mutex> lock(output_mutex_);
+      std::cout << "Observer \"" << number_ << "\": a new message is available --> " << message_from_subject_ << "\n";
+    }
+  }
+
+private:
+  static std::mutex output_mutex_;
+  std::string message_from_subject_;
+  int number_;
+  std::chrono::microseconds cost_;
+  bool verbose_;
+};
+
+std::mutex Observer::output_mutex_;
+
+void ClientCode() {
+  FanOutSubject subject(2, 4, OverflowPolicy::kBlock);
+  std::shared_ptr<Observer> observer1 = std::make_shared<Observer>(1);
+  std::shared_ptr<Observer> observer2 = std::make_shared<Observer>(2);
+  std::shared_ptr<Observer> observer3 = std::make_shared<Observer>(3);
+
+  subject.Attach(observer1);
+  subject.Attach(observer2);
+  subject.Attach(observer3);
+  subject.Detach(observer1);
+
+  subject.CreateMessage("Hello there!");
+  subject.Drain();
+  subject.Detach(observer2);
+  subject.CreateMessage("change message message");
+  subject.Drain();
+}
+
+const char* PolicyName(OverflowPolicy policy) {
+  switch (policy) {
+    case OverflowPolicy::kBlock:
+      return "block";
+    case OverflowPolicy::kDropOldest:
+      return "drop-oldest";
+    case OverflowPolicy::kConflate:
+      return "conflate";
+  }
+  return "?";
+}
+
+/**
+ * Benchmark: many cheap observers plus one that needs 1 ms per update. The
+ * sequential baseline is what Subject::Notify in Observer.cpp would do.
+ */
+void Benchmark(std::size_t observers, std::size_t messages, std::size_t workers) {
+  using Clock = std::chrono::steady_clock;
+  const std::chrono::microseconds slow_cost(1000);
+  const std::chrono::microseconds fast_cost(0);
+
+  {
+    std::vector<std::shared_ptr<Observer>> list;
+    list.push_back(std::make_shared<Observer>(0, slow_cost, false));
+    for (std::size_t i = 1; i < observers; ++i) {
+      list.push_back(std::make_shared<Observer>(static_cast<int>(i), fast_cost, false));
+    }
+    Clock::time_point start = Clock::now();
+    for (std::size_t m = 0; m < messages; ++m) {
+      for (const std::shared_ptr<Observer>& observer : list) {
+        observer->Update("tick " + std::to_string(m));
+      }
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << "  sequential    : producer " << ms << " ms\n";
+  }
+
+  for (OverflowPolicy policy : {OverflowPolicy::kBlock, OverflowPolicy::kDropOldest, OverflowPolicy::kConflate}) {
+    FanOutSubject subject(workers, 64, policy);
+    subject.Attach(std::make_shared<Observer>(0, slow_cost, false));
+    for (std::size_t i = 1; i < observers; ++i) {
+      subject.Attach(std::make_shared<Observer>(static_cast<int>(i), fast_cost, false));
+    }
+
+    Clock::time_point start = Clock::now();
+    for (std::size_t m = 0; m < messages; ++m) {
+      subject.CreateMessage("tick " + std::to_string(m));
+    }
+    double produce_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::vector<ObserverMetrics> metrics = subject.Metrics();
+    subject.Drain();
+    double drain_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::vector<ObserverMetrics> final_metrics = subject.Metrics();
+    std::size_t fast_max_lag = 0;
+    double fast_latency = 0;
+    for (std::size_t i = 1; i < final_metrics.size(); ++i) {
+      fast_max_lag = std::max(fast_max_lag, final_metrics[i].max_lag);
+      fast_latency = std::max(fast_latency, final_metrics[i].max_latency_us);
+    }
+    const ObserverMetrics& slow = final_metrics[0];
+    std::cout << "  " << std::left << std::setw(14) << PolicyName(policy) << std::right
+              << ": producer " << produce_ms << " ms, drained " << drain_ms << " ms"
+              << " | slow observer: lag at end of burst " << metrics[0].lag << ", delivered " << slow.delivered
+              << ", dropped " << slow.dropped << ", conflated " << slow.conflated
+              << ", max latency " << slow.max_latency_us / 1000 << " ms"
+              << " | fast observers: max lag " << fast_max_lag << ", max latency " << fast_latency / 1000 << " ms\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  ClientCode();
+
+  std::size_t messages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+  std::size_t workers = std::max(2u, std::thread::hardware_concurrency());
+  std::cout << "\nBenchmark: 64 observers (one slow), " << messages << " messages, " << workers << " workers\n";
+  Benchmark(64, messages, workers);
+  return 0;
+}
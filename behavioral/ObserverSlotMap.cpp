@@ -0,0 +1,338 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+class IObserver {
+public:
+  virtual ~IObserver() {}
+  virtual void Update(const std::string& message_from_subject) = 0;
+};
+
+/**
+ * A handle names a slot plus the generation the slot had when the handle was
+ * issued. Once the slot is freed its generation moves on, so stale handles
+ * are detected instead of silently hitting whatever reuses the slot.
+ */
+struct ObserverHandle {
+  std::uint32_t index = ~std::uint32_t(0);
+  std::uint32_t generation = 0;
+};
+
+/**
+ * SlotMap keeps its values densely packed in one vector. An indirection table
+ * of slots maps handles to dense positions, and removal swaps the last value
+ * into the hole, so insert, erase and lookup are all O(1) and iteration is a
+ * linear scan over contiguous memory. Removal does not preserve order.
+ */
+template <typename T>
+class SlotMap {
+public:
+  ObserverHandle Insert(T value) {
+    std::uint32_t index;
+    if (free_head_ != kNoSlot) {
+      index = free_head_;
+      free_head_ = slots_[index].dense;
+    } else {
+      index = static_cast<std::uint32_t>(slots_.size());
+      slots_.push_back(Slot());
+    }
+    slots_[index].dense = static_cast<std::uint32_t>(dense_.size());
+    dense_.push_back(value);
+    dense_to_slot_.push_back(index);
+
+    ObserverHandle handle;
+    handle.index = index;
+    handle.generation = slots_[index].generation;
+    return handle;
+  }
+
+  bool Erase(ObserverHandle handle) {
+    if (!Contains(handle)) {
+      return false;
+    }
+    Slot& slot = slots_[handle.index];
+    std::uint32_t hole = slot.dense;
+    std::uint32_t last = static_cast<std::uint32_t>(dense_.size() - 1);
+    if (hole != last) {
+      dense_[hole] = dense_[last];
+      dense_to_slot_[hole] = dense_to_slot_[last];
+      slots_[dense_to_slot_[hole]].dense = hole;
+    }
+    dense_.pop_back();
+    dense_to_slot_.pop_back();
+
+    ++slot.generation;
+    slot.dense = free_head_;
+    free_head_ = handle.index;
+    return true;
+  }
+
+  bool Contains(ObserverHandle handle) const {
+    return handle.index < slots_.size() && slots_[handle.index].generation == handle.generation;
+  }
+
+  void Reserve(std::size_t n) {
+    slots_.reserve(n);
+    dense_.reserve(n);
+    dense_to_slot_.reserve(n);
+  }
+
+  std::size_t size() const {
+    return dense_.size();
+  }
+
+  typename std::vector<T>::const_iterator begin() const {
+    return dense_.begin();
+  }
+
+  typename std::vector<T>::const_iterator end() const {
+    return dense_.end();
+  }
+
+private:
+  static constexpr std::uint32_t kNoSlot = ~std::uint32_t(0);
+
+  // For a live slot |dense| is the position of its value; for a free slot it
+  // links to the next free slot.
+  struct Slot {
+    std::uint32_t dense = kNoSlot;
+    std::uint32_t generation = 0;
+  };
+
+  std::vector<Slot> slots_;
+  std::vector<T> dense_;
+  std::vector<std::uint32_t> dense_to_slot_;
+  std::uint32_t free_head_ = kNoSlot;
+};
+
+/**
+ * The registry does not own its observers; it stores plain pointers and hands
+ * out handles. Observers must detach before they are destroyed, and must not
+ * attach or detach from inside Update().
+ */
+class SlotMapSubject {
+public:
+  virtual ~SlotMapSubject() {}
+
+  ObserverHandle Attach(IObserver* observer) {
+    return observers_.Insert(observer);
+  }
+
+  bool Detach(ObserverHandle handle) {
+    return observers_.Erase(handle);
+  }
+
+  void Notify() {
+    for (IObserver* observer : observers_) {
+      observer->Update(message_);
+    }
+  }
+
+  void CreateMessage(std::string message = "Empty") {
+    this->message_ = message;
+    Notify();
+  }
+
+  void HowManyObserver() {
+    std::cout << "There are " << observers_.size() << " observers in the list.\n";
+  }
+
+  void Reserve(std::size_t n) {
+    observers_.Reserve(n);
+  }
+
+private:
+  SlotMap<IObserver*> observers_;
+  std::string message_;
+};
+
+class Observer : public IObserver {
+public:
+  Observer(SlotMapSubject& subject) : subject_(subject) {
+    std::cout << "Hi, I'm the Observer \"" << ++Observer::static_number_ << "\".\n";
+    this->number_ = Observer::static_number_;
+  }
+
+  virtual ~Observer() {
+    subject_.Detach(handle_);
+    std::cout << "Goodbye, I was the Observer \"" << this->number_ << "\".\n";
+  }
+
+  void Update(const std::string& message_from_subject) override {
+    message_from_subject_ = message_from_subject;
+    PrintInfo();
+  }
+
+  void AttachToSubject() {
+    handle_ = subject_.Attach(this);
+  }
+
+  void RemoveMeFromTheList() {
+    subject_.Detach(handle_);
+    std::cout << "Observer \"" << number_ << "\" removed from the list.\n";
+  }
+
+  void PrintInfo() {
+    std::cout << "Observer \"" << this->number_ << "\": a new message is available --> " << this->message_from_subject_ << "\n";
+  }
+
+private:
+  std::string message_from_subject_;
+  SlotMapSubject& subject_;
+  ObserverHandle handle_;
+  static int static_number_;
+  int number_;
+};
+
+int Observer::static_number_ = 0;
+
+void ClientCode() {
+  SlotMapSubject subject;
+
+  subject.CreateMessage("Welcome! :D");
+  Observer observer1(subject);
+  Observer observer2(subject);
+  Observer observer3(subject);
+
+  observer1.AttachToSubject();
+  observer2.AttachToSubject();
+  observer3.AttachToSubject();
+
+  observer1.RemoveMeFromTheList();
+
+  subject.HowManyObserver();
+  subject.CreateMessage("Hello there!");
+
+  observer2.RemoveMeFromTheList();
+
+  subject.HowManyObserver();
+  subject.CreateMessage("change message message");
+}
+
+/**
+ * Benchmark-only pieces: a silent observer and the list-based Subject from
+ * Observer.cpp without its console output.
+ */
+class CountingObserver : public IObserver {
+public:
+  void Update(const std::string& message_from_subject) override {
+    message_from_subject_ = message_from_subject;
+    ++updates_;
+  }
+
+  std::size_t updates() const {
+    return updates_;
+  }
+
+  ObserverHandle handle;
+
+private:
+  std::string message_from_subject_;
+  std::size_t updates_ = 0;
+};
+
+class ListSubject {
+public:
+  void Attach(std::shared_ptr<IObserver> observer) {
+    list_observer_.push_back(observer);
+  }
+
+  void Detach(std::shared_ptr<IObserver> observer) {
+    list_observer_.remove(observer);
+  }
+
+  void CreateMessage(std::string message) {
+    message_ = message;
+    for (const std::shared_ptr<IObserver>& observer : list_observer_) {
+      observer->Update(message_);
+    }
+  }
+
+private:
+  std::list<std::shared_ptr<IObserver>> list_observer_;
+  std::string message_;
+};
+
+void Benchmark(std::size_t count) {
+  using Clock = std::chrono::steady_clock;
+  auto ns_per = [](Clock::duration d, std::size_t n) {
+    return std::chrono::duration<double, std::nano>(d).count() / n;
+  };
+
+  std::size_t notifications = std::max<std::size_t>(1, 10000000 / count);
+  std::size_t detaches = std::min<std::size_t>(count, 100);
+  std::mt19937 rng(7);
+  std::vector<std::size_t> victims(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    victims[i] = i;
+  }
+  std::shuffle(victims.begin(), victims.end(), rng);
+  victims.resize(detaches);
+
+  {
+    std::vector<std::shared_ptr<CountingObserver>> observers;
+    for (std::size_t i = 0; i < count; ++i) {
+      observers.push_back(std::make_shared<CountingObserver>());
+    }
+    ListSubject subject;
+    Clock::time_point start = Clock::now();
+    for (const std::shared_ptr<CountingObserver>& observer : observers) {
+      subject.Attach(observer);
+    }
+    Clock::time_point attached = Clock::now();
+    for (std::size_t i = 0; i < notifications; ++i) {
+      subject.CreateMessage("Hello there!");
+    }
+    Clock::time_point notified = Clock::now();
+    for (std::size_t victim : victims) {
+      subject.Detach(observers[victim]);
+    }
+    Clock::time_point detached = Clock::now();
+    std::cout << "  std::list   attach " << ns_per(attached - start, count) << " ns, notify "
+              << ns_per(notified - attached, count * notifications) << " ns/observer, detach "
+              << ns_per(detached - notified, detaches) << " ns\n";
+  }
+
+  {
+    std::vector<CountingObserver> observers(count);
+    SlotMapSubject subject;
+    subject.Reserve(count);
+    Clock::time_point start = Clock::now();
+    for (CountingObserver& observer : observers) {
+      observer.handle = subject.Attach(&observer);
+    }
+    Clock::time_point attached = Clock::now();
+    for (std::size_t i = 0; i < notifications; ++i) {
+      subject.CreateMessage("Hello there!");
+    }
+    Clock::time_point notified = Clock::now();
+    for (std::size_t victim : victims) {
+      subject.Detach(observers[victim].handle);
+    }
+    Clock::time_point detached = Clock::now();
+    std::cout << "  slot map    attach " << ns_per(attached - start, count) << " ns, notify "
+              << ns_per(notified - attached, count * notifications) << " ns/observer, detach "
+              << ns_per(detached - notified, detaches) << " ns\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  ClientCode();
+
+  std::size_t max_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  for (std::size_t count : {std::size_t(10), std::size_t(10000), std::size_t(1000000)}) {
+    if (count > max_count) {
+      break;
+    }
+    std::cout << "\nBenchmark: " << count << " observers\n";
+    Benchmark(count);
+  }
+  return 0;
+}
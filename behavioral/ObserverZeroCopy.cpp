@@ -0,0 +1,265 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * SharedMessage is an immutable, reference-counted message buffer. The
+ * Subject builds it once per CreateMessage(); handing it to an observer costs
+ * nothing, and an observer that wants to keep it pays one reference count
+ * increment instead of a copy of the payload.
+ */
+class SharedMessage {
+public:
+  SharedMessage() = default;
+
+  explicit SharedMessage(std::string payload)
+      : buffer_(std::make_shared<const std::string>(std::move(payload))) {
+  }
+
+  std::string_view view() const {
+    return buffer_ ? std::string_view(*buffer_) : std::string_view();
+  }
+
+  std::size_t size() const {
+    return buffer_ ? buffer_->size() : 0;
+  }
+
+  long use_count() const {
+    return buffer_.use_count();
+  }
+
+private:
+  std::shared_ptr<const std::string> buffer_;
+};
+
+class IObserver {
+public:
+  virtual ~IObserver() {}
+  // The view is only valid during the call; retain |message| to keep it.
+  virtual void Update(const SharedMessage& message_from_subject) = 0;
+};
+
+class ISubject {
+public:
+  virtual ~ISubject() {}
+  virtual void Attach(std::shared_ptr<IObserver> observer) = 0;
+  virtual void Detach(std::shared_ptr<IObserver> observer) = 0;
+  virtual void Notify() = 0;
+};
+
+class Subject : public ISubject, public std::enable_shared_from_this<Subject> {
+public:
+  virtual ~Subject() {
+    std::cout << "Goodbye, I was the Subject.\n";
+  }
+
+  void Attach(std::shared_ptr<IObserver> observer) override {
+    list_observer_.push_back(observer);
+  }
+
+  void Detach(std::shared_ptr<IObserver> observer) override {
+    list_observer_.remove(observer);
+  }
+
+  void Notify() override {
+    for (const std::shared_ptr<IObserver>& observer : list_observer_) {
+      observer->Update(message_);
+    }
+  }
+
+  // The payload is moved into a fresh buffer, so messages that observers
+  // still hold are never modified.
+  void CreateMessage(std::string message = "Empty") {
+    this->message_ = SharedMessage(std::move(message));
+    Notify();
+  }
+
+  void HowManyObserver() {
+    std::cout << "There are " << list_observer_.size() << " observers in the list.\n";
+  }
+
+private:
+  std::list<std::shared_ptr<IObserver>> list_observer_;
+  SharedMessage message_;
+};
+
+class Observer : public IObserver, public std::enable_shared_from_this<Observer> {
+public:
+  Observer(std::shared_ptr<Subject> subject) : subject_(subject) {
+    std::cout << "Hi, I'm the Observer \"" << ++Observer::static_number_ << "\".\n";
+    this->number_ = Observer::static_number_;
+  }
+
+  virtual ~Observer() {
+    std::cout << "Goodbye, I was the Observer \"" << this->number_ << "\".\n";
+  }
+
+  void Update(const SharedMessage& message_from_subject) override {
+    message_from_subject_ = message_from_subject;
+    PrintInfo();
+  }
+
+  void AttachToSubject() {
+    subject_->Attach(shared_from_this());
+  }
+
+  void RemoveMeFromTheList() {
+    subject_->Detach(shared_from_this());
+    std::cout << "Observer \"" << number_ << "\" removed from the list.\n";
+  }
+
+  void PrintInfo() {
+    std::cout << "Observer \"" << this->number_ << "\": a new message is available --> " << this->message_from_subject_.view()
+              << " (shared by " << message_from_subject_.use_count() << ")\n";
+  }
+
+private:
+  SharedMessage message_from_subject_;
+  std::shared_ptr<Subject> subject_;
+  static int static_number_;
+  int number_;
+};
+
+int Observer::static_number_ = 0;
+
+void ClientCode() {
+  std::shared_ptr<Subject> subject = std::make_shared<Subject>();
+
+  subject->CreateMessage("Welcome! :D");
+  std::shared_ptr<Observer> observer1 = std::make_shared<Observer>(subject);
+  std::shared_ptr<Observer> observer2 = std::make_shared<Observer>(subject);
+  std::shared_ptr<Observer> observer3 = std::make_shared<Observer>(subject);
+
+  observer1->AttachToSubject();
+  observer2->AttachToSubject();
+  observer3->AttachToSubject();
+
+  observer1->RemoveMeFromTheList();
+
+  subject->CreateMessage("Hello there!");
+
+  observer2->RemoveMeFromTheList();
+
+  subject->CreateMessage("change message message");
+}
+
+/**
+ * Benchmark: the copying delivery of Observer.cpp (every observer copies the
+ * std::string) against shared delivery (every observer retains the buffer).
+ */
+namespace copying {
+
+class IObserver {
+public:
+  virtual ~IObserver() {}
+  virtual void Update(const std::string& message_from_subject) = 0;
+};
+
+class Observer : public IObserver {
+public:
+  void Update(const std::string& message_from_subject) override {
+    message_from_subject_ = message_from_subject;
+  }
+
+private:
+  std::string message_from_subject_;
+};
+
+class Subject {
+public:
+  void Attach(std::shared_ptr<IObserver> observer) {
+    list_observer_.push_back(observer);
+  }
+
+  void CreateMessage(std::string message) {
+    message_ = message;
+    for (const std::shared_ptr<IObserver>& observer : list_observer_) {
+      observer->Update(message_);
+    }
+  }
+
+private:
+  std::list<std::shared_ptr<IObserver>> list_observer_;
+  std::string message_;
+};
+
+}  // namespace copying
+
+class RetainingObserver : public IObserver {
+public:
+  void Update(const SharedMessage& message_from_subject) override {
+    message_from_subject_ = message_from_subject;
+  }
+
+private:
+  SharedMessage message_from_subject_;
+};
+
+class QuietSubject {
+public:
+  void Attach(std::shared_ptr<IObserver> observer) {
+    list_observer_.push_back(observer);
+  }
+
+  void CreateMessage(std::string message) {
+    message_ = SharedMessage(std::move(message));
+    for (const std::shared_ptr<IObserver>& observer : list_observer_) {
+      observer->Update(message_);
+    }
+  }
+
+private:
+  std::list<std::shared_ptr<IObserver>> list_observer_;
+  SharedMessage message_;
+};
+
+template <typename SubjectT, typename ObserverT>
+double TimeCreateMessage(std::size_t observers, std::size_t payload, std::size_t rounds) {
+  using Clock = std::chrono::steady_clock;
+  SubjectT subject;
+  for (std::size_t i = 0; i < observers; ++i) {
+    subject.Attach(std::make_shared<ObserverT>());
+  }
+  std::vector<std::string> messages;
+  for (std::size_t r = 0; r < rounds + 1; ++r) {
+    messages.push_back(std::string(payload, static_cast<char>('a' + r % 26)));
+  }
+
+  // The first round warms up the observers' buffers.
+  subject.CreateMessage(std::move(messages[0]));
+  Clock::time_point start = Clock::now();
+  for (std::size_t r = 1; r <= rounds; ++r) {
+    subject.CreateMessage(std::move(messages[r]));
+  }
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rounds;
+}
+
+int main(int argc, char* argv[]) {
+  ClientCode();
+
+  std::size_t max_bytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::size_t(1) << 30;
+  std::cout << "\nBenchmark: CreateMessage cost in microseconds\n\n";
+  std::cout << std::setw(10) << "payload" << std::setw(11) << "observers"
+            << std::setw(14) << "copying" << std::setw(14) << "shared" << std::setw(10) << "speedup\n";
+  for (std::size_t payload : {std::size_t(64), std::size_t(4096), std::size_t(65536), std::size_t(1) << 20}) {
+    for (std::size_t observers : {std::size_t(1000), std::size_t(10000)}) {
+      if (payload * observers > max_bytes) {
+        continue;
+      }
+      std::size_t rounds = std::max<std::size_t>(3, std::min<std::size_t>(1000, (std::size_t(256) << 20) / (payload * observers)));
+      double copy_us = TimeCreateMessage<copying::Subject, copying::Observer>(observers, payload, rounds);
+      double shared_us = TimeCreateMessage<QuietSubject, RetainingObserver>(observers, payload, rounds);
+      std::cout << std::setw(10) << payload << std::setw(11) << observers
+                << std::setw(14) << copy_us << std::setw(14) << shared_us
+                << std::setw(9) << copy_us / shared_us << "x\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,191 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * The State.cpp machine as a closed transition table (see StateTable.cpp):
+ * A -request1-> B, B -request2-> A.
+ */
+enum class StateId : std::uint8_t { kA, kB };
+enum class Event : std::uint8_t { kRequest1, kRequest2 };
+
+constexpr std::size_t kStateCount = 2;
+constexpr std::size_t kEventCount = 2;
+
+constexpr const char* kStateNames[kStateCount] = {"ConcreteStateA", "ConcreteStateB"};
+
+constexpr StateId kTransitions[kStateCount][kEventCount] = {
+    /* ConcreteStateA */ {StateId::kB, StateId::kA},
+    /* ConcreteStateB */ {StateId::kB, StateId::kA},
+};
+
+// What happened to one request: the state that handled it, the state the
+// context moved to, and how many times the request lost a race and had to be
+// re-evaluated against a newer state.
+struct Outcome {
+    StateId from;
+    StateId to;
+    unsigned retries;
+};
+
+/**
+ * AtomicContext keeps the current state as an atomic state ID. A request
+ * reads the state, looks up the transition and publishes it with a single
+ * compare-and-swap. If another thread changed the state in the meantime the
+ * CAS fails, hands back the new state, and the request is simply evaluated
+ * again against it, so every request is handled by exactly the state that
+ * was current when it took effect. Requests that do not change the state
+ * need no write at all.
+ */
+class AtomicContext {
+public:
+    explicit AtomicContext(StateId initial = StateId::kA) : state_(initial) {
+    }
+
+    StateId state() const {
+        return state_.load(std::memory_order_acquire);
+    }
+
+    Outcome Request1() {
+        return Dispatch(Event::kRequest1);
+    }
+
+    Outcome Request2() {
+        return Dispatch(Event::kRequest2);
+    }
+
+    Outcome Dispatch(Event event) {
+        Outcome outcome{state_.load(std::memory_order_acquire), StateId::kA, 0};
+        for (;;) {
+            outcome.to = kTransitions[static_cast<std::size_t>(outcome.from)][static_cast<std::size_t>(event)];
+            if (outcome.to == outcome.from) {
+                return outcome;
+            }
+            if (state_.compare_exchange_weak(outcome.from, outcome.to,
+                                             std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return outcome;
+            }
+            ++outcome.retries;
+        }
+    }
+
+private:
+    alignas(64) std::atomic<StateId> state_;
+};
+
+/**
+ * Baseline for the benchmark: the same table behind a mutex.
+ */
+class LockedContext {
+public:
+    Outcome Dispatch(Event event) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Outcome outcome{state_, kTransitions[static_cast<std::size_t>(state_)][static_cast<std::size_t>(event)], 0};
+        state_ = outcome.to;
+        return outcome;
+    }
+
+    StateId state() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return state_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    StateId state_ = StateId::kA;
+};
+
+void ClientCode() {
+    AtomicContext context;
+    std::cout << "Context: starts in " << kStateNames[static_cast<std::size_t>(context.state())] << ".\n";
+
+    std::vector<std::thread> threads;
+    std::mutex output;
+    for (int t = 0; t < 2; ++t) {
+        threads.emplace_back([&context, &output, t]() {
+            Outcome outcome = t == 0 ? context.Request1() : context.Request2();
+            std::lock_guard<std::mutex> lock(output);
+            std::cout << kStateNames[static_cast<std::size_t>(outcome.from)] << " handles request" << (t + 1)
+                      << " -> " << kStateNames[static_cast<std::size_t>(outcome.to)]
+                      << " (" << outcome.retries << " retries)\n";
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::cout << "Context: ends in " << kStateNames[static_cast<std::size_t>(context.state())] << ".\n";
+}
+
+/**
+ * Every thread issues a random mix of requests. Afterwards the number of A->B
+ * transitions minus B->A transitions must match the final state, which
+ * proves no transition was lost or applied twice.
+ */
+template <typename ContextT>
+void RunBenchmark(const char* name, std::size_t threads, std::size_t requests_per_thread) {
+    using Clock = std::chrono::steady_clock;
+    ContextT context;
+    std::vector<std::int64_t> balance(threads * 8);
+    std::vector<std::uint64_t> retries(threads * 8);
+    std::vector<std::thread> pool;
+
+    Clock::time_point start = Clock::now();
+    for (std::size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t]() {
+            std::uint64_t seed = 0x9e3779b97f4a7c15ULL * (t + 1);
+            std::int64_t local_balance = 0;
+            std::uint64_t local_retries = 0;
+            for (std::size_t i = 0; i < requests_per_thread; ++i) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                Outcome outcome = context.Dispatch((seed & 1) ? Event::kRequest1 : Event::kRequest2);
+                local_balance += static_cast<int>(outcome.to) - static_cast<int>(outcome.from);
+                local_retries += outcome.retries;
+            }
+            balance[t * 8] = local_balance;
+            retries[t * 8] = local_retries;
+        });
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::int64_t total_balance = 0;
+    std::uint64_t total_retries = 0;
+    for (std::size_t t = 0; t < threads; ++t) {
+        total_balance += balance[t * 8];
+        total_retries += retries[t * 8];
+    }
+    double requests = static_cast<double>(threads * requests_per_thread);
+    std::cout << std::setw(12) << requests / seconds / 1e6;
+    if (total_retries > 0) {
+        std::cout << " (" << std::setprecision(3) << total_retries / requests << " retries/req)" << std::setprecision(6);
+    }
+    if (total_balance != static_cast<int>(context.state())) {
+        std::cout << " " << name << " LOST A TRANSITION";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    ClientCode();
+
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::cout << "\nBenchmark: million requests/s, " << requests << " requests per thread\n\n";
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "mutex" << "  " << std::setw(12) << "CAS" << "\n";
+    for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+        std::cout << std::setw(8) << threads;
+        RunBenchmark<LockedContext>("mutex", threads, requests);
+        std::cout << "  ";
+        RunBenchmark<AtomicContext>("CAS", threads, requests);
+        std::cout << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,250 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/**
+ * The State.cpp machine again, as a closed transition table (see
+ * StateTable.cpp): A -request1-> B, B -request2-> A.
+ */
+enum class StateId : std::uint8_t { kA, kB };
+enum class Event : std::uint8_t { kRequest1, kRequest2 };
+
+constexpr std::size_t kStateCount = 2;
+constexpr std::size_t kEventCount = 2;
+constexpr std::size_t kKeyCount = kStateCount * kEventCount;
+
+constexpr const char* kStateNames[kStateCount] = {"ConcreteStateA", "ConcreteStateB"};
+
+constexpr StateId kTransitions[kStateCount][kEventCount] = {
+    /* ConcreteStateA */ {StateId::kB, StateId::kA},
+    /* ConcreteStateB */ {StateId::kB, StateId::kA},
+};
+
+/**
+ * BatchEngine owns the current state of many independent contexts, one byte
+ * each. Apply() takes one event per context and advances all of them at once.
+ *
+ * Instead of physically sorting the contexts by state (a pass of its own),
+ * the kernel evaluates every (state, event) group as a masked select over the
+ * whole chunk: each group contributes its target state where the mask
+ * matches. There are no data-dependent branches, so the loop auto-vectorizes,
+ * and a second vectorized pass over the group keys counts how often each
+ * group was handled. The contexts are split into contiguous chunks, one per
+ * worker thread.
+ */
+class BatchEngine {
+public:
+    BatchEngine(std::size_t contexts, std::size_t threads, StateId initial = StateId::kA)
+        : states_(contexts, static_cast<std::uint8_t>(initial)),
+          threads_(std::max<std::size_t>(threads, 1)) {
+    }
+
+    std::size_t size() const {
+        return states_.size();
+    }
+
+    StateId state(std::size_t context) const {
+        return static_cast<StateId>(states_[context]);
+    }
+
+    // |events| must hold size() entries; throws std::invalid_argument
+    // otherwise.
+    void Apply(const std::vector<Event>& events) {
+        if (events.size() != states_.size()) {
+            throw std::invalid_argument("BatchEngine::Apply: need one event per context");
+        }
+        const std::uint8_t* in = reinterpret_cast<const std::uint8_t*>(events.data());
+        std::size_t count = states_.size();
+        std::size_t workers = std::min(threads_, std::max<std::size_t>(1, count / kMinChunk));
+        std::vector<Counts> partial(workers);
+
+        if (workers == 1) {
+            Kernel(states_.data(), in, count, partial[0]);
+        } else {
+            std::vector<std::thread> pool;
+            std::size_t chunk = (count + workers - 1) / workers;
+            for (std::size_t w = 0; w < workers; ++w) {
+                std::size_t begin = w * chunk;
+                std::size_t end = std::min(count, begin + chunk);
+                pool.emplace_back([this, in, begin, end, &partial, w]() {
+                    Kernel(states_.data() + begin, in + begin, end - begin, partial[w]);
+                });
+            }
+            for (std::thread& worker : pool) {
+                worker.join();
+            }
+        }
+
+        for (const Counts& counts : partial) {
+            for (std::size_t k = 0; k < kKeyCount; ++k) {
+                handled_[k] += counts.value[k];
+            }
+        }
+    }
+
+    std::uint64_t handled(StateId state, Event event) const {
+        return handled_[static_cast<std::size_t>(state) * kEventCount + static_cast<std::size_t>(event)];
+    }
+
+    std::size_t CountIn(StateId state) const {
+        return std::count(states_.begin(), states_.end(), static_cast<std::uint8_t>(state));
+    }
+
+private:
+    static constexpr std::size_t kMinChunk = 1 << 16;
+
+    struct alignas(64) Counts {
+        std::uint64_t value[kKeyCount] = {};
+    };
+
+    static void Kernel(std::uint8_t* states, const std::uint8_t* events, std::size_t count, Counts& counts) {
+        std::uint8_t next_of[kKeyCount];
+        for (std::size_t k = 0; k < kKeyCount; ++k) {
+            next_of[k] = static_cast<std::uint8_t>(kTransitions[k / kEventCount][k % kEventCount]);
+        }
+
+        // First pass: select the next state and remember the group key.
+        // Second pass: count each group. Both loops are branch-free byte
+        // loops the compiler vectorizes.
+        const std::size_t kBlock = 4096;
+        std::uint8_t keys[kBlock];
+        for (std::size_t base = 0; base < count; base += kBlock) {
+            std::size_t length = std::min(kBlock, count - base);
+            std::uint8_t* block_states = states + base;
+            const std::uint8_t* block_events = events + base;
+            for (std::size_t i = 0; i < length; ++i) {
+                std::uint8_t key = static_cast<std::uint8_t>(block_states[i] * kEventCount + block_events[i]);
+                std::uint8_t next = next_of[0];
+                for (std::size_t k = 1; k < kKeyCount; ++k) {
+                    next = key == k ? next_of[k] : next;
+                }
+                keys[i] = key;
+                block_states[i] = next;
+            }
+            for (std::size_t k = 0; k < kKeyCount; ++k) {
+                std::uint8_t wanted = static_cast<std::uint8_t>(k);
+                std::uint32_t matches = 0;
+                for (std::size_t i = 0; i < length; ++i) {
+                    matches += keys[i] == wanted ? 1u : 0u;
+                }
+                counts.value[k] += matches;
+            }
+        }
+    }
+
+    std::vector<std::uint8_t> states_;
+    std::size_t threads_;
+    std::uint64_t handled_[kKeyCount] = {};
+};
+
+/**
+ * Baseline: one heap-allocated context object per machine, like the Context
+ * of StateTable.cpp, dispatched one at a time.
+ */
+class TableContext {
+public:
+    void Dispatch(Event event) {
+        std::size_t from = static_cast<std::size_t>(state_);
+        std::size_t on = static_cast<std::size_t>(event);
+        ++handled_[from][on];
+        state_ = kTransitions[from][on];
+    }
+
+    StateId state() const {
+        return state_;
+    }
+
+private:
+    StateId state_ = StateId::kA;
+    std::uint64_t handled_[kStateCount][kEventCount] = {};
+};
+
+void ClientCode() {
+    BatchEngine engine(4, 1);
+    std::cout << "Client: four contexts start in " << kStateNames[0] << ".\n";
+    engine.Apply({Event::kRequest1, Event::kRequest2, Event::kRequest1, Event::kRequest2});
+    engine.Apply({Event::kRequest2, Event::kRequest1, Event::kRequest1, Event::kRequest2});
+    for (std::size_t i = 0; i < engine.size(); ++i) {
+        std::cout << "Context " << i << " is in " << kStateNames[static_cast<std::size_t>(engine.state(i))] << ".\n";
+    }
+    std::cout << "ConcreteStateA handled request1 " << engine.handled(StateId::kA, Event::kRequest1) << " times.\n";
+}
+
+std::vector<Event> RandomEvents(std::size_t count, std::uint64_t seed) {
+    std::vector<Event> events(count);
+    for (Event& event : events) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        event = (seed & 1) ? Event::kRequest1 : Event::kRequest2;
+    }
+    return events;
+}
+
+int main(int argc, char* argv[]) {
+    using Clock = std::chrono::steady_clock;
+
+    ClientCode();
+
+    std::size_t max_contexts = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::size_t(16) << 20;
+    std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> thread_counts = {1};
+    for (std::size_t t = 2; t < cores; t *= 2) {
+        thread_counts.push_back(t);
+    }
+    if (cores > 1) {
+        thread_counts.push_back(cores);
+    }
+
+    std::cout << "\nBenchmark: million events/s, 8 batches per run\n\n";
+    std::cout << std::setw(10) << "contexts" << std::setw(12) << "objects";
+    for (std::size_t threads : thread_counts) {
+        std::cout << std::setw(10) << ("batch x" + std::to_string(threads));
+    }
+    std::cout << "\n";
+
+    const std::size_t kBatches = 8;
+    for (std::size_t contexts = 4096; contexts <= max_contexts; contexts *= 4) {
+        std::vector<std::vector<Event>> batches;
+        for (std::size_t b = 0; b < kBatches; ++b) {
+            batches.push_back(RandomEvents(contexts, 0x9e3779b97f4a7c15ULL + b));
+        }
+        double events = static_cast<double>(contexts) * kBatches;
+
+        std::vector<std::unique_ptr<TableContext>> objects;
+        for (std::size_t i = 0; i < contexts; ++i) {
+            objects.push_back(std::make_unique<TableContext>());
+        }
+        Clock::time_point start = Clock::now();
+        for (const std::vector<Event>& batch : batches) {
+            for (std::size_t i = 0; i < contexts; ++i) {
+                objects[i]->Dispatch(batch[i]);
+            }
+        }
+        double object_s = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << std::setw(10) << contexts << std::setw(12) << events / object_s / 1e6;
+
+        for (std::size_t threads : thread_counts) {
+            BatchEngine engine(contexts, threads);
+            start = Clock::now();
+            for (const std::vector<Event>& batch : batches) {
+                engine.Apply(batch);
+            }
+            double batch_s = std::chrono::duration<double>(Clock::now() - start).count();
+            std::cout << std::setw(10) << events / batch_s / 1e6;
+            if (engine.CountIn(StateId::kB) != static_cast<std::size_t>(std::count_if(objects.begin(), objects.end(),
+                    [](const std::unique_ptr<TableContext>& context) { return context->state() == StateId::kB; }))) {
+                std::cout << " (mismatch!)";
+            }
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
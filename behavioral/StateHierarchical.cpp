@@ -0,0 +1,358 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+/**
+ * A hierarchical version of the State.cpp machine:
+ *
+ *   Root
+ *   +-- Operational            (Fault -> Maintenance)
+ *   |   +-- ConcreteStateA     (Request1 -> ConcreteStateB, Request2 handled in place)
+ *   |   +-- ConcreteStateB     (Request2 -> ConcreteStateA, Request1 handled in place)
+ *   +-- Maintenance            (Reset -> Operational, which starts in ConcreteStateA)
+ *
+ * A leaf that does not react to an event passes it to its parent, so Fault
+ * only has to be written down once for both concrete states.
+ */
+enum StateId : std::uint8_t { kRoot, kOperational, kStateA, kStateB, kMaintenance, kStateCount };
+enum Event : std::uint8_t { kRequest1, kRequest2, kFault, kReset, kEventCount };
+
+constexpr std::uint8_t kNoState = 0xff;
+
+constexpr const char* kStateNames[kStateCount] = {"Root", "Operational", "ConcreteStateA", "ConcreteStateB", "Maintenance"};
+constexpr const char* kEventNames[kEventCount] = {"request1", "request2", "fault", "reset"};
+
+constexpr std::uint8_t kParent[kStateCount] = {kNoState, kRoot, kOperational, kOperational, kRoot};
+constexpr std::uint8_t kDepth[kStateCount] = {0, 1, 2, 2, 1};
+constexpr std::uint8_t kInitial[kStateCount] = {kOperational, kStateA, kNoState, kNoState, kNoState};
+
+// kReactions[state][event]: kNoState passes the event to the parent, the
+// state itself means "handled without a transition", anything else is the
+// transition target.
+constexpr std::uint8_t kReactions[kStateCount][kEventCount] = {
+    /* Root        */ {kNoState, kNoState, kNoState, kNoState},
+    /* Operational */ {kNoState, kNoState, kMaintenance, kNoState},
+    /* StateA      */ {kStateB, kStateA, kNoState, kNoState},
+    /* StateB      */ {kStateB, kStateA, kNoState, kNoState},
+    /* Maintenance */ {kNoState, kNoState, kNoState, kOperational},
+};
+
+/**
+ * TransitionTrace remembers the last N transitions in a fixed ring buffer.
+ * Writers claim a slot with one fetch_add and publish it with a per-slot
+ * sequence number, so recording never blocks and never allocates. Dump() can
+ * run on any thread while the machine keeps going; a record that is being
+ * overwritten during the dump is recognised by its sequence number and
+ * skipped.
+ */
+class TransitionTrace {
+public:
+    struct Record {
+        std::uint8_t from;
+        std::uint8_t to;
+        std::uint8_t event;
+        std::int64_t timestamp_ns;
+    };
+
+    // |capacity| is rounded up to a power of two.
+    explicit TransitionTrace(std::size_t capacity) {
+        std::size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots_ = std::vector<Slot>(size);
+        mask_ = size - 1;
+    }
+
+    void Append(std::uint8_t from, std::uint8_t to, std::uint8_t event) {
+        std::uint64_t index = head_.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots_[index & mask_];
+        std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.packed.store(static_cast<std::uint32_t>(from) | static_cast<std::uint32_t>(to) << 8 |
+                          static_cast<std::uint32_t>(event) << 16, std::memory_order_relaxed);
+        slot.timestamp_ns.store(now, std::memory_order_relaxed);
+        slot.sequence.store(index + 1, std::memory_order_release);
+    }
+
+    // Copies out the surviving records, oldest first.
+    std::vector<Record> Snapshot() const {
+        std::vector<Record> records;
+        std::uint64_t head = head_.load(std::memory_order_acquire);
+        std::uint64_t first = head > slots_.size() ? head - slots_.size() : 0;
+        for (std::uint64_t index = first; index < head; ++index) {
+            const Slot& slot = slots_[index & mask_];
+            std::uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            std::uint32_t packed = slot.packed.load(std::memory_order_relaxed);
+            std::int64_t timestamp = slot.timestamp_ns.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            std::uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+            if (before != index + 1 || after != before) {
+                continue;
+            }
+            records.push_back(Record{static_cast<std::uint8_t>(packed), static_cast<std::uint8_t>(packed >> 8),
+                                     static_cast<std::uint8_t>(packed >> 16), timestamp});
+        }
+        return records;
+    }
+
+    void Dump(std::ostream& out) const {
+        std::vector<Record> records = Snapshot();
+        out << "Last " << records.size() << " transitions:\n";
+        for (const Record& record : records) {
+            out << "  " << record.timestamp_ns << " ns  " << kStateNames[record.from] << " --" << kEventNames[record.event]
+                << "--> " << kStateNames[record.to] << "\n";
+        }
+    }
+
+    std::uint64_t total() const {
+        return head_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct alignas(32) Slot {
+        std::atomic<std::uint64_t> sequence{0};
+        std::atomic<std::uint32_t> packed{0};
+        std::atomic<std::int64_t> timestamp_ns{0};
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t mask_ = 0;
+    alignas(64) std::atomic<std::uint64_t> head_{0};
+};
+
+/**
+ * HierarchicalContext owns the current leaf state and a bounded
+ * run-to-completion queue. Post() only enqueues; Process() dispatches queued
+ * events one by one, and an event posted while another is being handled (for
+ * example from an entry action) waits until the current one has completed.
+ * One queue slot beyond |queue_capacity| is kept for events posted by entry
+ * actions, so a full queue of client events cannot make the machine lose,
+ * say, the Reset that takes it out of Maintenance.
+ * The context itself is single-threaded; the trace may be shared.
+ */
+class HierarchicalContext {
+public:
+    HierarchicalContext(TransitionTrace* trace = nullptr, std::size_t queue_capacity = 64, std::ostream* log = nullptr)
+        : queue_(queue_capacity + kActionSlots), trace_(trace), log_(log) {
+        state_ = kRoot;
+        EnterInitial(kRoot);
+    }
+
+    std::uint8_t state() const {
+        return state_;
+    }
+
+    bool IsIn(std::uint8_t state) const {
+        for (std::uint8_t s = state_; s != kNoState; s = kParent[s]) {
+            if (s == state) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns false and counts the event in dropped() if the queue is full.
+    bool Post(Event event) {
+        return Enqueue(event, queue_.size() - kActionSlots);
+    }
+
+    // Runs queued events to completion. Returns the number processed.
+    std::size_t Process() {
+        std::size_t processed = 0;
+        while (count_ > 0) {
+            Event event = queue_[head_];
+            head_ = (head_ + 1) % queue_.size();
+            --count_;
+            Dispatch(event);
+            ++processed;
+        }
+        return processed;
+    }
+
+    std::uint64_t unhandled() const {
+        return unhandled_;
+    }
+
+    std::uint64_t dropped() const {
+        return dropped_;
+    }
+
+private:
+    // Slots only entry and exit actions may use.
+    static constexpr std::size_t kActionSlots = 1;
+
+    bool Enqueue(Event event, std::size_t capacity) {
+        if (count_ >= capacity) {
+            ++dropped_;
+            return false;
+        }
+        queue_[(head_ + count_) % queue_.size()] = event;
+        ++count_;
+        return true;
+    }
+
+    void Dispatch(Event event) {
+        for (std::uint8_t handler = state_; handler != kNoState; handler = kParent[handler]) {
+            std::uint8_t target = kReactions[handler][event];
+            if (target == kNoState) {
+                continue;
+            }
+            if (log_) {
+                *log_ << kStateNames[handler] << " handles " << kEventNames[event] << ".\n";
+            }
+            if (target != handler) {
+                TransitionTo(handler, target, event);
+            }
+            return;
+        }
+        ++unhandled_;
+    }
+
+    void TransitionTo(std::uint8_t source, std::uint8_t target, Event event) {
+        std::uint8_t from = state_;
+
+        // Least common ancestor of the source and the target.
+        std::uint8_t a = source;
+        std::uint8_t b = target;
+        while (kDepth[a] > kDepth[b]) {
+            a = kParent[a];
+        }
+        while (kDepth[b] > kDepth[a]) {
+            b = kParent[b];
+        }
+        while (a != b) {
+            a = kParent[a];
+            b = kParent[b];
+        }
+        std::uint8_t ancestor = a == target ? kParent[target] : a;
+
+        for (std::uint8_t s = state_; s != ancestor; s = kParent[s]) {
+            OnExit(s);
+        }
+
+        std::uint8_t path[kStateCount];
+        std::size_t depth = 0;
+        for (std::uint8_t s = target; s != ancestor; s = kParent[s]) {
+            path[depth++] = s;
+        }
+        while (depth > 0) {
+            OnEntry(path[--depth]);
+        }
+        state_ = target;
+        EnterInitial(target);
+
+        if (trace_) {
+            trace_->Append(from, state_, event);
+        }
+    }
+
+    void EnterInitial(std::uint8_t state) {
+        for (std::uint8_t child = kInitial[state]; child != kNoState; child = kInitial[child]) {
+            OnEntry(child);
+            state_ = child;
+        }
+    }
+
+    // Entry and exit actions. Maintenance schedules its own Reset; thanks to
+    // run-to-completion it is handled only after the Fault transition that
+    // entered Maintenance has finished.
+    void OnEntry(std::uint8_t state) {
+        if (log_) {
+            *log_ << "Context: Enter " << kStateNames[state] << ".\n";
+        }
+        if (state == kMaintenance) {
+            // Dispatch has just freed a slot and the action slot is spare, so
+            // this cannot fail; if it ever did, dropped() would show it.
+            Enqueue(kReset, queue_.size());
+        }
+    }
+
+    void OnExit(std::uint8_t state) {
+        if (log_) {
+            *log_ << "Context: Exit " << kStateNames[state] << ".\n";
+        }
+    }
+
+    std::vector<Event> queue_;
+    std::size_t head_ = 0;
+    std::size_t count_ = 0;
+    std::uint8_t state_;
+    std::uint64_t unhandled_ = 0;
+    std::uint64_t dropped_ = 0;
+    TransitionTrace* trace_;
+    std::ostream* log_;
+};
+
+void ClientCode() {
+    TransitionTrace trace(16);
+    HierarchicalContext context(&trace, 64, &std::cout);
+
+    context.Post(kRequest1);
+    context.Post(kRequest2);
+    context.Post(kRequest1);
+    context.Post(kFault);
+    context.Post(kReset);
+    context.Process();
+
+    std::cout << "\nContext: ignored " << context.unhandled() << " event(s). Transition trace:\n";
+    trace.Dump(std::cout);
+}
+
+int main(int argc, char* argv[]) {
+    using Clock = std::chrono::steady_clock;
+
+    ClientCode();
+
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    std::vector<Event> events(count);
+    std::uint64_t seed = 0x2545f4914f6cdd1dULL;
+    for (Event& event : events) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        std::uint64_t roll = seed % 100;
+        event = roll < 48 ? kRequest1 : roll < 96 ? kRequest2 : roll < 98 ? kFault : kReset;
+    }
+    std::cout << "\nBenchmark: " << count << " events posted in batches of 32\n";
+
+    TransitionTrace trace(1 << 12);
+    std::ostringstream sink;
+    // The stream variant formats like the std::cout trace in State.cpp's
+    // TransitionTo, into memory; it runs on a tenth of the events.
+    struct Variant {
+        const char* name;
+        TransitionTrace* trace;
+        std::ostream* log;
+        std::size_t divisor;
+    } variants[] = {
+        {"no tracing      ", nullptr, nullptr, 1},
+        {"ring-buffer trace", &trace, nullptr, 1},
+        {"ostream trace   ", nullptr, &sink, 10},
+    };
+
+    for (const Variant& variant : variants) {
+        HierarchicalContext context(variant.trace, 64, variant.log);
+        std::size_t total = count / variant.divisor;
+        Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < total; i += 32) {
+            for (std::size_t j = i; j < i + 32 && j < total; ++j) {
+                context.Post(events[j]);
+            }
+            context.Process();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "  " << variant.name << ": " << total / seconds / 1e6 << " M events/s"
+                  << (context.dropped() ? " (dropped events!)" : "") << "\n";
+        sink.str("");
+    }
+    std::cout << "  trace recorded " << trace.total() << " transitions, keeps the last 4096\n";
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <typeinfo>
+#include <vector>
+
+/**
+ * The same two-state machine as State.cpp, but closed: the states and the
+ * requests are enumerations and the behaviour lives in a constexpr transition
+ * table. Handling a request is one indexed load from the table; nothing is
+ * allocated, reference counted or looked up through RTTI.
+ */
+enum class StateId : std::uint8_t { kA, kB };
+enum class Event : std::uint8_t { kRequest1, kRequest2 };
+
+constexpr std::size_t kStateCount = 2;
+constexpr std::size_t kEventCount = 2;
+
+constexpr const char* kStateNames[kStateCount] = {"ConcreteStateA", "ConcreteStateB"};
+constexpr const char* kEventNames[kEventCount] = {"request1", "request2"};
+
+struct Transition {
+    StateId next;
+};
+
+// Rows are states, columns are events. A -request1-> B and B -request2-> A;
+// every other request is handled without a transition.
+constexpr Transition kTransitions[kStateCount][kEventCount] = {
+    /* ConcreteStateA */ {{StateId::kB}, {StateId::kA}},
+    /* ConcreteStateB */ {{StateId::kB}, {StateId::kA}},
+};
+
+class TableContext {
+public:
+    explicit TableContext(StateId initial = StateId::kA, bool verbose = false)
+        : state_(initial), verbose_(verbose) {
+    }
+
+    StateId state() const {
+        return state_;
+    }
+
+    void Request1() {
+        Dispatch(Event::kRequest1);
+    }
+
+    void Request2() {
+        Dispatch(Event::kRequest2);
+    }
+
+    void Dispatch(Event event) {
+        std::size_t from = static_cast<std::size_t>(state_);
+        std::size_t on = static_cast<std::size_t>(event);
+        StateId next = kTransitions[from][on].next;
+        ++handled_[from][on];
+        if (verbose_) {
+            std::cout << kStateNames[from] << " handles " << kEventNames[on] << ".\n";
+            if (next != state_) {
+                std::cout << "Context: Transition to " << kStateNames[static_cast<std::size_t>(next)] << ".\n";
+            }
+        }
+        state_ = next;
+    }
+
+    std::uint64_t handled(StateId state, Event event) const {
+        return handled_[static_cast<std::size_t>(state)][static_cast<std::size_t>(event)];
+    }
+
+private:
+    StateId state_;
+    bool verbose_;
+    std::uint64_t handled_[kStateCount][kEventCount] = {};
+};
+
+/**
+ * The State.cpp design with its console output removed, kept for the
+ * benchmark. TransitionTo still allocates, takes shared_from_this() and asks
+ * typeid for the state name.
+ */
+namespace classic {
+
+class State;
+
+class Context : public std::enable_shared_from_this<Context> {
+private:
+    std::shared_ptr<State> state_;
+
+public:
+    const char* last_name_ = nullptr;
+
+    void TransitionTo(const std::shared_ptr<State>& state);
+    void Request1();
+    void Request2();
+};
+
+class State {
+protected:
+    std::weak_ptr<Context> context_;
+
+public:
+    virtual ~State() {}
+
+    void set_context(const std::shared_ptr<Context>& context) {
+        context_ = context;
+    }
+
+    virtual void Handle1() = 0;
+    virtual void Handle2() = 0;
+};
+
+class ConcreteStateA : public State {
+public:
+    void Handle1() override;
+    void Handle2() override {}
+};
+
+class ConcreteStateB : public State {
+public:
+    void Handle1() override {}
+    void Handle2() override;
+};
+
+void Context::TransitionTo(const std::shared_ptr<State>& state) {
+    last_name_ = typeid(*state).name();
+    state_ = state;
+    state_->set_context(shared_from_this());
+}
+
+void Context::Request1() {
+    state_->Handle1();
+}
+
+void Context::Request2() {
+    state_->Handle2();
+}
+
+void ConcreteStateA::Handle1() {
+    if (auto context = context_.lock()) {
+        context->TransitionTo(std::make_shared<ConcreteStateB>());
+    }
+}
+
+void ConcreteStateB::Handle2() {
+    if (auto context = context_.lock()) {
+        context->TransitionTo(std::make_shared<ConcreteStateA>());
+    }
+}
+
+}  // namespace classic
+
+void ClientCode() {
+    TableContext context(StateId::kA, true);
+    std::cout << "Context: Transition to " << kStateNames[static_cast<std::size_t>(context.state())] << ".\n";
+
+    context.Request1();
+    context.Request2();
+}
+
+int main(int argc, char* argv[]) {
+    using Clock = std::chrono::steady_clock;
+
+    ClientCode();
+
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    std::vector<Event> events(count);
+    std::uint64_t seed = 0x2545f4914f6cdd1dULL;
+    for (Event& event : events) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        event = (seed & 1) ? Event::kRequest1 : Event::kRequest2;
+    }
+    std::cout << "\nBenchmark: " << count << " random requests\n";
+
+    std::shared_ptr<classic::Context> classicContext = std::make_shared<classic::Context>();
+    classicContext->TransitionTo(std::make_shared<classic::ConcreteStateA>());
+    Clock::time_point start = Clock::now();
+    for (Event event : events) {
+        if (event == Event::kRequest1) {
+            classicContext->Request1();
+        } else {
+            classicContext->Request2();
+        }
+    }
+    double classic_s = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "  shared_ptr states: " << count / classic_s / 1e6 << " M requests/s (ends in "
+              << classicContext->last_name_ << ")\n";
+
+    TableContext tableContext;
+    start = Clock::now();
+    for (Event event : events) {
+        tableContext.Dispatch(event);
+    }
+    double table_s = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "  transition table : " << count / table_s / 1e6 << " M requests/s (ends in "
+              << kStateNames[static_cast<std::size_t>(tableContext.state())] << ", "
+              << tableContext.handled(StateId::kA, Event::kRequest1) << " A->B transitions)\n";
+    std::cout << "  speedup          : " << classic_s / table_s << "x\n";
+    return 0;
+}
@@ -0,0 +1,538 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+/**
+ * The Strategy interface declares operations common to all supported versions
+ * of some algorithm.
+ */
+class Strategy
+{
+public:
+    virtual ~Strategy() {}
+    virtual std::string DoAlgorithm(const std::vector<std::string> &data) const = 0;
+};
+
+/**
+ * Three interchangeable ways to produce the same ascending result. Which one
+ * is fastest depends on the input: insertion sort wins on a handful of
+ * characters and on input that is already in order, std::sort in the middle,
+ * and counting sort (see StrategyCounting.cpp) once the input is large.
+ */
+class ConcreteStrategyA : public Strategy
+{
+public:
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::string result;
+        std::for_each(std::begin(data), std::end(data), [&result](const std::string &letter) {
+            result += letter;
+        });
+        std::sort(std::begin(result), std::end(result));
+
+        return result;
+    }
+};
+
+class InsertionSortStrategy : public Strategy
+{
+public:
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::string result;
+        std::for_each(std::begin(data), std::end(data), [&result](const std::string &letter) {
+            result += letter;
+        });
+        for (std::size_t i = 1; i < result.size(); ++i)
+        {
+            char value = result[i];
+            std::size_t j = i;
+            for (; j > 0 && result[j - 1] > value; --j)
+            {
+                result[j] = result[j - 1];
+            }
+            result[j] = value;
+        }
+
+        return result;
+    }
+};
+
+class CountingSortStrategy : public Strategy
+{
+public:
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::uint64_t counts[256] = {};
+        std::size_t total = 0;
+        for (const std::string &chunk : data)
+        {
+            for (char c : chunk)
+            {
+                ++counts[static_cast<unsigned char>(c)];
+            }
+            total += chunk.size();
+        }
+
+        std::string result(total, '\0');
+        char *out = &result[0];
+        for (int value = CHAR_MIN; value <= CHAR_MAX; ++value)
+        {
+            unsigned char byte = static_cast<unsigned char>(value);
+            std::memset(out, byte, counts[byte]);
+            out += counts[byte];
+        }
+
+        return result;
+    }
+};
+
+enum class InputShape
+{
+    kRandom,
+    kPresorted
+};
+
+constexpr std::size_t kShapeCount = 2;
+constexpr const char *kShapeNames[kShapeCount] = {"random", "presorted"};
+
+// From |size| characters on, |to| is faster than |from|.
+struct Crossover
+{
+    std::size_t size;
+    std::string from;
+    std::string to;
+};
+
+/**
+ * StrategySelector keeps a table of the fastest registered strategy per input
+ * shape and size class, where size class k covers 2^(k-1) < size <= 2^k
+ * characters.
+ *
+ * Calibrate() fills the table by timing every strategy on synthetic samples
+ * of each size class. A strategy that is more than ten times slower than the
+ * winner and still clearly losing ground is not timed again for larger sizes of that
+ * shape, so an O(n^2) candidate does not make calibration itself quadratic,
+ * while one with a high fixed cost stays in the running.
+ *
+ * With set_retune_every(n), every n-th Run() also times the other candidates
+ * on the real input and updates the table entry for it, so the choice follows
+ * the machine and the data instead of the startup guess.
+ */
+class StrategySelector
+{
+public:
+    void Register(const std::string &name, std::shared_ptr<Strategy> strategy)
+    {
+        candidates_.push_back(Candidate{name, std::move(strategy)});
+    }
+
+    // Throws std::logic_error if no candidate is registered.
+    void Calibrate(std::size_t max_size = std::size_t(1) << 20)
+    {
+        if (candidates_.empty())
+        {
+            throw std::logic_error("StrategySelector: no candidates registered");
+        }
+        std::size_t classes = SizeClass(max_size) + 1;
+        for (std::size_t shape = 0; shape < kShapeCount; ++shape)
+        {
+            cells_[shape].assign(classes, Cell{std::vector<double>(candidates_.size(), kPruned), 0});
+            // Each candidate's slowdown against the winner at the previous size.
+            std::vector<double> ratio(candidates_.size(), std::numeric_limits<double>::max());
+            for (std::size_t size_class = 0; size_class < classes; ++size_class)
+            {
+                std::vector<std::string> sample = Sample(std::size_t(1) << size_class, static_cast<InputShape>(shape));
+                Cell &cell = cells_[shape][size_class];
+                for (std::size_t c = 0; c < candidates_.size(); ++c)
+                {
+                    cell.seconds[c] = ratio[c] == kPruned ? kPruned : 0;
+                }
+                Measure(cell, sample, size_class > 0 ? cells_[shape][size_class - 1].winner : kNone);
+                for (std::size_t c = 0; c < candidates_.size(); ++c)
+                {
+                    double now = cell.seconds[c] / cell.seconds[cell.winner];
+                    // Losing ground means clearly, not by timing noise.
+                    ratio[c] = now > 10 && now > 1.5 * ratio[c] ? kPruned : now;
+                }
+            }
+        }
+    }
+
+    void set_retune_every(std::size_t calls)
+    {
+        retune_every_ = calls;
+    }
+
+    // Run() and ChosenFor() throw std::logic_error before Calibrate().
+    std::string Run(const std::vector<std::string> &data)
+    {
+        std::size_t size = 0;
+        for (const std::string &chunk : data)
+        {
+            size += chunk.size();
+        }
+        InputShape shape = Classify(data, size);
+        Cell &cell = CellFor(size, shape);
+        ++calls_;
+
+        if (retune_every_ == 0 || calls_ % retune_every_ != 0)
+        {
+            last_choice_ = cell.winner;
+            return candidates_[cell.winner].strategy->DoAlgorithm(data);
+        }
+
+        // Retune: measure the candidates still in the running on this input
+        // the same way Calibrate() does; the current winner is the incumbent.
+        Measure(cell, data, cell.winner);
+        last_choice_ = cell.winner;
+        ++retunes_;
+        return candidates_[cell.winner].strategy->DoAlgorithm(data);
+    }
+
+    // Throws std::logic_error before the first Run().
+    const std::string &last_choice() const
+    {
+        if (last_choice_ == kNone)
+        {
+            throw std::logic_error("StrategySelector: Run() has not been called");
+        }
+        return candidates_[last_choice_].name;
+    }
+
+    const std::string &ChosenFor(std::size_t size, InputShape shape) const
+    {
+        return candidates_[CellFor(size, shape).winner].name;
+    }
+
+    std::vector<Crossover> Crossovers(InputShape shape) const
+    {
+        std::vector<Crossover> crossovers;
+        const std::vector<Cell> &cells = cells_[static_cast<std::size_t>(shape)];
+        for (std::size_t size_class = 1; size_class < cells.size(); ++size_class)
+        {
+            std::size_t from = cells[size_class - 1].winner;
+            std::size_t to = cells[size_class].winner;
+            if (from != to)
+            {
+                crossovers.push_back(Crossover{(std::size_t(1) << (size_class - 1)) + 1, candidates_[from].name,
+                                               candidates_[to].name});
+            }
+        }
+        return crossovers;
+    }
+
+    std::size_t retunes() const
+    {
+        return retunes_;
+    }
+
+    // Samples up to 64 evenly spaced characters of the concatenated input;
+    // if none of them is smaller than the one before, the input is treated as
+    // already in order.
+    static InputShape Classify(const std::vector<std::string> &data, std::size_t size)
+    {
+        std::size_t step = std::max<std::size_t>(1, size / 64);
+        std::size_t next = 0;
+        std::size_t offset = 0;
+        char previous = CHAR_MIN;
+        for (const std::string &chunk : data)
+        {
+            for (; next < offset + chunk.size(); next += step)
+            {
+                char c = chunk[next - offset];
+                if (c < previous)
+                {
+                    return InputShape::kRandom;
+                }
+                previous = c;
+            }
+            offset += chunk.size();
+        }
+        return InputShape::kPresorted;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr double kPruned = std::numeric_limits<double>::infinity();
+    static constexpr std::size_t kNone = std::numeric_limits<std::size_t>::max();
+
+    struct Candidate
+    {
+        std::string name;
+        std::shared_ptr<Strategy> strategy;
+    };
+
+    struct Cell
+    {
+        std::vector<double> seconds;
+        std::size_t winner;
+    };
+
+    static std::size_t SizeClass(std::size_t size)
+    {
+        std::size_t size_class = 0;
+        while ((std::size_t(1) << size_class) < size)
+        {
+            ++size_class;
+        }
+        return size_class;
+    }
+
+    // Inputs beyond the calibrated range use the largest size class. Throws
+    // std::logic_error before Calibrate().
+    const Cell &CellFor(std::size_t size, InputShape shape) const
+    {
+        const std::vector<Cell> &cells = cells_[static_cast<std::size_t>(shape)];
+        if (cells.empty())
+        {
+            throw std::logic_error("StrategySelector: Calibrate() has not been called");
+        }
+        return cells[std::min(SizeClass(size), cells.size() - 1)];
+    }
+
+    Cell &CellFor(std::size_t size, InputShape shape)
+    {
+        return const_cast<Cell &>(static_cast<const StrategySelector *>(this)->CellFor(size, shape));
+    }
+
+    static void Elect(Cell &cell)
+    {
+        cell.winner = std::min_element(cell.seconds.begin(), cell.seconds.end()) - cell.seconds.begin();
+    }
+
+    // Times every candidate not pruned from |cell| on |sample| and elects the
+    // fastest. Timings of near-equal candidates are noise, so |incumbent|
+    // (kNone for no incumbent) keeps the cell unless another candidate is
+    // clearly faster.
+    void Measure(Cell &cell, const std::vector<std::string> &sample, std::size_t incumbent) const
+    {
+        for (std::size_t c = 0; c < candidates_.size(); ++c)
+        {
+            if (cell.seconds[c] != kPruned)
+            {
+                cell.seconds[c] = Time(*candidates_[c].strategy, sample);
+            }
+        }
+        Elect(cell);
+        if (incumbent != kNone && cell.seconds[incumbent] <= 1.05 * cell.seconds[cell.winner])
+        {
+            cell.winner = incumbent;
+        }
+    }
+
+    // Lower-case text in strings of up to 16 characters.
+    static std::vector<std::string> Sample(std::size_t size, InputShape shape)
+    {
+        std::string text(size, 'a');
+        std::uint64_t seed = 0x9e3779b97f4a7c15ULL ^ size;
+        for (char &c : text)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            c = static_cast<char>('a' + (seed >> 32) % 26);
+        }
+        if (shape == InputShape::kPresorted)
+        {
+            std::sort(text.begin(), text.end());
+        }
+        std::vector<std::string> sample;
+        for (std::size_t i = 0; i < size; i += 16)
+        {
+            sample.push_back(text.substr(i, 16));
+        }
+        return sample;
+    }
+
+    // Best of three, each repeated until it has run for at least 100 us.
+    static double Time(const Strategy &strategy, const std::vector<std::string> &sample)
+    {
+        double best = kPruned;
+        for (int round = 0; round < 3; ++round)
+        {
+            std::size_t repeats = 0;
+            Clock::time_point start = Clock::now();
+            Clock::duration elapsed;
+            do
+            {
+                std::string result = strategy.DoAlgorithm(sample);
+                ++repeats;
+                elapsed = Clock::now() - start;
+            } while (elapsed < std::chrono::microseconds(100));
+            best = std::min(best, std::chrono::duration<double>(elapsed).count() / repeats);
+        }
+        return best;
+    }
+
+    std::vector<Candidate> candidates_;
+    std::vector<Cell> cells_[kShapeCount];
+    std::size_t retune_every_ = 0;
+    std::size_t calls_ = 0;
+    std::size_t retunes_ = 0;
+    std::size_t last_choice_ = kNone;
+};
+
+/**
+ * The Context works with a fixed strategy as in Strategy.cpp, or, once a
+ * selector is set, lets the selector pick the strategy for every call.
+ */
+class Context
+{
+private:
+    std::shared_ptr<Strategy> strategy_;
+    std::unique_ptr<StrategySelector> selector_;
+
+public:
+    Context(std::shared_ptr<Strategy> strategy = nullptr) : strategy_(strategy)
+    {
+    }
+    void set_strategy(std::shared_ptr<Strategy> strategy)
+    {
+        this->strategy_ = strategy;
+        this->selector_.reset();
+    }
+    void set_selector(std::unique_ptr<StrategySelector> selector)
+    {
+        this->selector_ = std::move(selector);
+    }
+    // Null unless the Context is in automatic mode.
+    const StrategySelector *selector() const
+    {
+        return this->selector_.get();
+    }
+    std::string Sort(const std::vector<std::string> &data)
+    {
+        if (this->selector_)
+        {
+            return this->selector_->Run(data);
+        }
+        return this->strategy_->DoAlgorithm(data);
+    }
+    void DoSomeBusinessLogic()
+    {
+        std::cout << "Context: Sorting data using the strategy (not sure how it'll do it)\n";
+        std::string result = Sort(std::vector<std::string>{"a", "e", "c", "b", "d"});
+        std::cout << result << "\n";
+    }
+};
+
+std::unique_ptr<StrategySelector> MakeSelector()
+{
+    std::unique_ptr<StrategySelector> selector(new StrategySelector);
+    selector->Register("insertion", std::make_shared<InsertionSortStrategy>());
+    selector->Register("std::sort", std::make_shared<ConcreteStrategyA>());
+    selector->Register("counting", std::make_shared<CountingSortStrategy>());
+    selector->Calibrate();
+    return selector;
+}
+
+void ClientCode()
+{
+    std::shared_ptr<Context> context = std::make_shared<Context>(std::make_shared<ConcreteStrategyA>());
+    std::cout << "Client: Strategy is set to normal sorting.\n";
+    context->DoSomeBusinessLogic();
+    std::cout << "\n";
+    std::cout << "Client: Context picks the strategy itself.\n";
+    context->set_selector(MakeSelector());
+    context->DoSomeBusinessLogic();
+    std::cout << "Context: picked " << context->selector()->last_choice() << ".\n\n";
+
+    for (std::size_t shape = 0; shape < kShapeCount; ++shape)
+    {
+        std::cout << "Crossovers for " << kShapeNames[shape] << " input:\n";
+        for (const Crossover &crossover : context->selector()->Crossovers(static_cast<InputShape>(shape)))
+        {
+            std::cout << "  from " << std::setw(8) << crossover.size << " characters: " << crossover.from << " -> "
+                      << crossover.to << "\n";
+        }
+    }
+}
+
+/**
+ * Benchmark: a stream of mostly small batches (1 to 64 characters) with an
+ * occasional large one (256 KB), the mix that a fixed choice gets wrong at
+ * one end or the other. The two kinds of batches are timed separately.
+ */
+int main(int argc, char *argv[])
+{
+    using Clock = std::chrono::steady_clock;
+
+    ClientCode();
+
+    std::size_t batches = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    std::vector<std::vector<std::string>> inputs[2];
+    std::uint64_t seed = 0x2545f4914f6cdd1dULL;
+    for (std::size_t b = 0; b < batches; ++b)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        bool large = b % 1000 == 999;
+        std::size_t size = large ? 256 * 1024 : 1 + seed % 64;
+        std::string text(size, 'a');
+        for (char &c : text)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            c = static_cast<char>('a' + (seed >> 32) % 26);
+        }
+        std::vector<std::string> input;
+        for (std::size_t i = 0; i < size; i += 16)
+        {
+            input.push_back(text.substr(i, 16));
+        }
+        inputs[large].push_back(std::move(input));
+    }
+    std::cout << "\nBenchmark: " << inputs[0].size() << " small and " << inputs[1].size() << " large batches\n\n";
+    std::cout << std::setw(17) << "context" << std::setw(12) << "small ms" << std::setw(12) << "large ms"
+              << "  checksum\n";
+
+    std::unique_ptr<Context> contexts[] = {
+        std::unique_ptr<Context>(new Context(std::make_shared<ConcreteStrategyA>())),
+        std::unique_ptr<Context>(new Context(std::make_shared<CountingSortStrategy>())),
+        std::unique_ptr<Context>(new Context),
+        std::unique_ptr<Context>(new Context),
+    };
+    const char *names[] = {"fixed std::sort", "fixed counting", "auto", "auto + retune"};
+    contexts[2]->set_selector(MakeSelector());
+    std::unique_ptr<StrategySelector> retuning = MakeSelector();
+    retuning->set_retune_every(1000);
+    contexts[3]->set_selector(std::move(retuning));
+
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        std::size_t checksum = 0;
+        std::cout << std::setw(17) << names[i];
+        for (const std::vector<std::vector<std::string>> &group : inputs)
+        {
+            Clock::time_point start = Clock::now();
+            for (const std::vector<std::string> &input : group)
+            {
+                checksum += static_cast<unsigned char>(contexts[i]->Sort(input).back());
+            }
+            std::cout << std::setw(12) << std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+        std::cout << "  " << checksum;
+        if (const StrategySelector *selector = contexts[i]->selector())
+        {
+            std::cout << " (32 chars -> " << selector->ChosenFor(32, InputShape::kRandom) << ", 256 KB -> "
+                      << selector->ChosenFor(256 * 1024, InputShape::kRandom) << ", " << selector->retunes()
+                      << " retunes)";
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
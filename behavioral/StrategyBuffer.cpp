@@ -0,0 +1,317 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+
+// Counts every call to the global operator new so the benchmark can show how
+// many heap allocations each interface performs per call. All the plain and
+// array forms are replaced together so every allocation is paired with the
+// matching deallocation. They are kept out of line: once inlined, GCC sees
+// malloc() paired with operator delete (or operator new with free()) and
+// warns about mismatched allocation functions.
+static std::size_t g_allocations = 0;
+
+static void *CountedAlloc(std::size_t size)
+{
+    ++g_allocations;
+    if (void *p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void *operator new(std::size_t size)
+{
+    return CountedAlloc(size);
+}
+
+__attribute__((noinline)) void *operator new[](std::size_t size)
+{
+    return CountedAlloc(size);
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+/**
+ * A non-owning view of a contiguous array, the part of C++20's std::span this
+ * file needs.
+ */
+template <typename T>
+class Span
+{
+public:
+    Span() = default;
+    Span(T *data, std::size_t size) : data_(data), size_(size)
+    {
+    }
+    template <std::size_t N>
+    Span(T (&array)[N]) : data_(array), size_(N)
+    {
+    }
+    T *data() const
+    {
+        return data_;
+    }
+    std::size_t size() const
+    {
+        return size_;
+    }
+    T *begin() const
+    {
+        return data_;
+    }
+    T *end() const
+    {
+        return data_ + size_;
+    }
+
+private:
+    T *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/**
+ * The Strategy interface of Strategy.cpp plus a buffer-oriented overload. The
+ * input is a span of string_views (or a single string_view), the output is a
+ * buffer owned by the caller, and nothing in between touches the heap.
+ *
+ * Like snprintf, the buffer overload returns the number of characters the
+ * result needs and only writes it if |out| is large enough, so a caller can
+ * size the buffer with an empty span first.
+ */
+class Strategy
+{
+public:
+    virtual ~Strategy() {}
+    virtual std::string DoAlgorithm(const std::vector<std::string> &data) const = 0;
+    virtual std::size_t DoAlgorithm(Span<const std::string_view> data, Span<char> out) const = 0;
+
+    std::size_t DoAlgorithm(std::string_view data, Span<char> out) const
+    {
+        return DoAlgorithm(Span<const std::string_view>(&data, 1), out);
+    }
+
+protected:
+    // Concatenates |data| into |out|; returns the total size, and false in
+    // |fits| if |out| is too small, in which case nothing is written.
+    static std::size_t Gather(Span<const std::string_view> data, Span<char> out, bool &fits)
+    {
+        std::size_t size = 0;
+        for (std::string_view piece : data)
+        {
+            size += piece.size();
+        }
+        fits = size <= out.size();
+        if (fits)
+        {
+            char *cursor = out.data();
+            for (std::string_view piece : data)
+            {
+                std::memcpy(cursor, piece.data(), piece.size());
+                cursor += piece.size();
+            }
+        }
+        return size;
+    }
+};
+
+// Number of characters in the concatenation of |pieces|.
+template <std::size_t N>
+constexpr std::size_t TotalSize(const std::string_view (&pieces)[N])
+{
+    std::size_t size = 0;
+    for (std::string_view piece : pieces)
+    {
+        size += piece.size();
+    }
+    return size;
+}
+
+class Context
+{
+private:
+    std::shared_ptr<Strategy> strategy_;
+
+public:
+    Context(std::shared_ptr<Strategy> strategy = nullptr) : strategy_(strategy)
+    {
+    }
+    void set_strategy(std::shared_ptr<Strategy> strategy)
+    {
+        this->strategy_ = strategy;
+    }
+    std::size_t Sort(Span<const std::string_view> data, Span<char> out) const
+    {
+        return this->strategy_->DoAlgorithm(data, out);
+    }
+    /**
+     * The input is a static array of views and the result goes to a stack
+     * buffer, so the business logic itself no longer allocates.
+     */
+    void DoSomeBusinessLogic() const
+    {
+        static constexpr std::string_view kData[] = {"a", "e", "c", "b", "d"};
+        char result[TotalSize(kData)];
+        std::cout << "Context: Sorting data using the strategy (not sure how it'll do it)\n";
+        std::size_t size = this->strategy_->DoAlgorithm(Span<const std::string_view>(kData), Span<char>(result));
+        if (size > sizeof(result))
+        {
+            std::cout << "Context: the result needs " << size << " characters, the buffer holds " << sizeof(result)
+                      << "\n";
+            return;
+        }
+        std::cout.write(result, size) << "\n";
+    }
+
+};
+
+class ConcreteStrategyA : public Strategy
+{
+public:
+    using Strategy::DoAlgorithm;
+
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::string result;
+        std::for_each(std::begin(data), std::end(data), [&result](const std::string &letter) {
+            result += letter;
+        });
+        std::sort(std::begin(result), std::end(result));
+
+        return result;
+    }
+    std::size_t DoAlgorithm(Span<const std::string_view> data, Span<char> out) const override
+    {
+        bool fits;
+        std::size_t size = Gather(data, out, fits);
+        if (fits)
+        {
+            std::sort(out.data(), out.data() + size);
+        }
+        return size;
+    }
+};
+class ConcreteStrategyB : public Strategy
+{
+public:
+    using Strategy::DoAlgorithm;
+
+private:
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::string result;
+        std::for_each(std::begin(data), std::end(data), [&result](const std::string &letter) {
+            result += letter;
+        });
+        std::sort(std::begin(result), std::end(result));
+        for (std::size_t i = 0; i < result.size() / 2; i++)
+        {
+            std::swap(result[i], result[result.size() - i - 1]);
+        }
+
+        return result;
+    }
+    std::size_t DoAlgorithm(Span<const std::string_view> data, Span<char> out) const override
+    {
+        bool fits;
+        std::size_t size = Gather(data, out, fits);
+        if (fits)
+        {
+            std::sort(out.data(), out.data() + size, [](char a, char b) { return a > b; });
+        }
+        return size;
+    }
+};
+
+void ClientCode()
+{
+    std::shared_ptr<Context> context = std::make_shared<Context>(std::make_shared<ConcreteStrategyA>());
+    std::cout << "Client: Strategy is set to normal sorting.\n";
+    context->DoSomeBusinessLogic();
+    std::cout << "\n";
+    std::cout << "Client: Strategy is set to reverse sorting.\n";
+    context->set_strategy(std::make_shared<ConcreteStrategyB>());
+    context->DoSomeBusinessLogic();
+}
+
+int main(int argc, char *argv[])
+{
+    using Clock = std::chrono::steady_clock;
+
+    ClientCode();
+
+    // Benchmark: the same words, 3 to 24 characters in up to 8 pieces, sorted
+    // through both interfaces. The old one needs the words as a vector of
+    // strings, built per call as DoSomeBusinessLogic does.
+    std::size_t calls = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::string_view kWords[] = {"strategy", "context", "sort", "buffer", "span", "view", "heap", "zero"};
+    std::cout << "\nBenchmark: " << calls << " calls\n";
+
+    ConcreteStrategyA normal;
+    ConcreteStrategyB reverse;
+    const Strategy *strategies[] = {&normal, &reverse};
+    for (const Strategy *strategy : strategies)
+    {
+        std::size_t checksum[2] = {};
+        std::size_t allocations = g_allocations;
+        Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < calls; ++i)
+        {
+            std::size_t count = 1 + i % 8;
+            std::vector<std::string> data(kWords, kWords + count);
+            std::string result = strategy->DoAlgorithm(data);
+            checksum[0] += static_cast<unsigned char>(result[i % result.size()]);
+        }
+        double vector_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+        double vector_allocations = static_cast<double>(g_allocations - allocations) / calls;
+
+        char out[64];
+        allocations = g_allocations;
+        start = Clock::now();
+        for (std::size_t i = 0; i < calls; ++i)
+        {
+            std::size_t count = 1 + i % 8;
+            std::size_t size = strategy->DoAlgorithm(Span<const std::string_view>(kWords, count), Span<char>(out));
+            checksum[1] += static_cast<unsigned char>(out[i % size]);
+        }
+        double buffer_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+        double buffer_allocations = static_cast<double>(g_allocations - allocations) / calls;
+
+        std::cout << "  " << (strategy == &normal ? "normal" : "reverse") << " sorting\n";
+        std::cout << "    vector<string> -> string: " << vector_ns << " ns/call, " << vector_allocations
+                  << " allocations/call\n";
+        std::cout << "    views -> caller buffer  : " << buffer_ns << " ns/call, " << buffer_allocations
+                  << " allocations/call (" << vector_ns / buffer_ns << "x)\n";
+        if (checksum[0] != checksum[1])
+        {
+            std::cout << "    (mismatch!)\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,241 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+/**
+ * The Strategy interface declares operations common to all supported versions
+ * of some algorithm.
+ */
+class Strategy
+{
+public:
+    virtual ~Strategy() {}
+    virtual std::string DoAlgorithm(const std::vector<std::string> &data) const = 0;
+};
+
+class Context
+{
+private:
+    std::shared_ptr<Strategy> strategy_;
+
+public:
+    Context(std::shared_ptr<Strategy> strategy = nullptr) : strategy_(strategy)
+    {
+    }
+    void set_strategy(std::shared_ptr<Strategy> strategy)
+    {
+        this->strategy_ = strategy;
+    }
+    void DoSomeBusinessLogic() const
+    {
+        std::cout << "Context: Sorting data using the strategy (not sure how it'll do it)\n";
+        std::string result = this->strategy_->DoAlgorithm(std::vector<std::string>{"a", "e", "c", "b", "d"});
+        std::cout << result << "\n";
+    }
+};
+
+/**
+ * The comparison-sort strategies of Strategy.cpp, unchanged, as the baseline.
+ */
+class ConcreteStrategyA : public Strategy
+{
+public:
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::string result;
+        std::for_each(std::begin(data), std::end(data), [&result](const std::string &letter) {
+            result += letter;
+        });
+        std::sort(std::begin(result), std::end(result));
+
+        return result;
+    }
+};
+class ConcreteStrategyB : public Strategy
+{
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::string result;
+        std::for_each(std::begin(data), std::end(data), [&result](const std::string &letter) {
+            result += letter;
+        });
+        std::sort(std::begin(result), std::end(result));
+        for (std::size_t i = 0; i < result.size() / 2; i++)
+        {
+            std::swap(result[i], result[result.size() - i - 1]);
+        }
+
+        return result;
+    }
+};
+
+enum class SortOrder
+{
+    kAscending,
+    kDescending
+};
+
+/**
+ * A character has only 256 possible values, so sorting characters does not
+ * need comparisons at all: count how often each value occurs, then write each
+ * value out that many times. Both passes are linear, and neither the input
+ * strings nor the counts are ever concatenated or moved around.
+ *
+ * The histogram reads eight bytes per load and spreads them over four
+ * separate count tables. Consecutive equal bytes (common in text) would
+ * otherwise increment the same counter back to back, and every increment
+ * would wait for the previous store. The fill is one memset per distinct
+ * value, which the C library runs with its widest vector stores.
+ *
+ * The output order matches std::sort on std::string, i.e. by char, which is
+ * signed on most platforms.
+ */
+class CountingSortStrategy : public Strategy
+{
+public:
+    explicit CountingSortStrategy(SortOrder order = SortOrder::kAscending) : order_(order)
+    {
+    }
+
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::uint64_t counts[4][256] = {};
+        std::size_t total = 0;
+        for (const std::string &chunk : data)
+        {
+            Histogram(reinterpret_cast<const unsigned char *>(chunk.data()), chunk.size(), counts);
+            total += chunk.size();
+        }
+
+        std::string result(total, '\0');
+        char *out = &result[0];
+        for (int i = 0; i <= UCHAR_MAX; ++i)
+        {
+            int value = order_ == SortOrder::kAscending ? CHAR_MIN + i : CHAR_MAX - i;
+            unsigned char byte = static_cast<unsigned char>(value);
+            std::uint64_t count = counts[0][byte] + counts[1][byte] + counts[2][byte] + counts[3][byte];
+            std::memset(out, byte, count);
+            out += count;
+        }
+
+        return result;
+    }
+
+private:
+    static void Histogram(const unsigned char *bytes, std::size_t size, std::uint64_t (&counts)[4][256])
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            ++counts[0][word & 0xff];
+            ++counts[1][(word >> 8) & 0xff];
+            ++counts[2][(word >> 16) & 0xff];
+            ++counts[3][(word >> 24) & 0xff];
+            ++counts[0][(word >> 32) & 0xff];
+            ++counts[1][(word >> 40) & 0xff];
+            ++counts[2][(word >> 48) & 0xff];
+            ++counts[3][word >> 56];
+        }
+        for (; i < size; ++i)
+        {
+            ++counts[0][bytes[i]];
+        }
+    }
+
+    SortOrder order_;
+};
+
+void ClientCode()
+{
+    std::shared_ptr<Context> context = std::make_shared<Context>(std::make_shared<CountingSortStrategy>());
+    std::cout << "Client: Strategy is set to counting sort.\n";
+    context->DoSomeBusinessLogic();
+    std::cout << "\n";
+    std::cout << "Client: Strategy is set to reverse counting sort.\n";
+    context->set_strategy(std::make_shared<CountingSortStrategy>(SortOrder::kDescending));
+    context->DoSomeBusinessLogic();
+}
+
+/**
+ * Random bytes over the full 0..255 range, split into 64 KB strings.
+ */
+std::vector<std::string> RandomData(std::size_t bytes, std::uint64_t seed)
+{
+    const std::size_t kChunk = 64 * 1024;
+    std::vector<std::string> data;
+    for (std::size_t done = 0; done < bytes; done += kChunk)
+    {
+        std::string chunk(std::min(kChunk, bytes - done), '\0');
+        for (char &c : chunk)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            c = static_cast<char>(seed >> 56);
+        }
+        data.push_back(std::move(chunk));
+    }
+    return data;
+}
+
+double Seconds(const Strategy &strategy, const std::vector<std::string> &data, std::string &result)
+{
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    result = strategy.DoAlgorithm(data);
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    ClientCode();
+
+    // Sizes from 1 KB to 1 GB, 32x apart. The largest run needs about three
+    // times its size in memory: the input, the baseline result and the result
+    // it is checked against.
+    std::size_t max_bytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::size_t(1) << 30;
+
+    std::cout << "\nBenchmark: MB/s\n\n";
+    std::cout << std::setw(12) << "bytes" << std::setw(12) << "std::sort" << std::setw(12) << "counting"
+              << std::setw(10) << "speedup" << std::setw(14) << "sort+reverse" << std::setw(12) << "counting"
+              << std::setw(10) << "speedup" << "\n";
+
+    ConcreteStrategyA sortA;
+    ConcreteStrategyB sortB;
+    CountingSortStrategy countingA(SortOrder::kAscending);
+    CountingSortStrategy countingB(SortOrder::kDescending);
+    const Strategy *baselines[] = {&sortA, &sortB};
+    const Strategy *candidates[] = {&countingA, &countingB};
+
+    for (std::size_t bytes = 1024; bytes <= max_bytes; bytes *= 32)
+    {
+        std::vector<std::string> data = RandomData(bytes, 0x9e3779b97f4a7c15ULL);
+        double megabytes = bytes / 1e6;
+        std::cout << std::setw(12) << bytes;
+        for (int order = 0; order < 2; ++order)
+        {
+            std::string expected;
+            std::string result;
+            double baseline_s = Seconds(*baselines[order], data, expected);
+            double counting_s = Seconds(*candidates[order], data, result);
+            std::cout << std::setw(order == 0 ? 12 : 14) << megabytes / baseline_s << std::setw(12)
+                      << megabytes / counting_s << std::setw(9) << baseline_s / counting_s << "x";
+            if (result != expected)
+            {
+                std::cout << " (mismatch!)";
+            }
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,510 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * A source hands out the input one chunk at a time. The view returned by
+ * Next() stays valid until the following call.
+ */
+class ChunkSource
+{
+public:
+    virtual ~ChunkSource() {}
+    // Returns false once the input is exhausted.
+    virtual bool Next(std::string_view &chunk) = 0;
+};
+
+/**
+ * A sink receives the sorted output in order, in pieces of any size.
+ */
+class ChunkSink
+{
+public:
+    virtual ~ChunkSink() {}
+    virtual void Write(std::string_view data) = 0;
+};
+
+/**
+ * The Strategy interface of Strategy.cpp with a streaming overload. Its
+ * default implementation gathers the whole source in memory and runs the
+ * in-memory algorithm, so every existing strategy works on streams unchanged;
+ * strategies that can do better override it.
+ */
+class Strategy
+{
+public:
+    virtual ~Strategy() {}
+    virtual std::string DoAlgorithm(const std::vector<std::string> &data) const = 0;
+    virtual void DoAlgorithm(ChunkSource &source, ChunkSink &sink) const
+    {
+        std::vector<std::string> data;
+        std::string_view chunk;
+        while (source.Next(chunk))
+        {
+            data.emplace_back(chunk);
+        }
+        sink.Write(DoAlgorithm(data));
+    }
+};
+
+class Context
+{
+private:
+    std::shared_ptr<Strategy> strategy_;
+
+public:
+    Context(std::shared_ptr<Strategy> strategy = nullptr) : strategy_(strategy)
+    {
+    }
+    void set_strategy(std::shared_ptr<Strategy> strategy)
+    {
+        this->strategy_ = strategy;
+    }
+    void DoSomeBusinessLogic() const
+    {
+        std::cout << "Context: Sorting data using the strategy (not sure how it'll do it)\n";
+        std::string result = this->strategy_->DoAlgorithm(std::vector<std::string>{"a", "e", "c", "b", "d"});
+        std::cout << result << "\n";
+    }
+    void Sort(ChunkSource &source, ChunkSink &sink) const
+    {
+        this->strategy_->DoAlgorithm(source, sink);
+    }
+};
+
+class ConcreteStrategyA : public Strategy
+{
+public:
+    using Strategy::DoAlgorithm;
+
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::string result;
+        std::for_each(std::begin(data), std::end(data), [&result](const std::string &letter) {
+            result += letter;
+        });
+        std::sort(std::begin(result), std::end(result));
+
+        return result;
+    }
+};
+
+class VectorSource : public ChunkSource
+{
+public:
+    explicit VectorSource(const std::vector<std::string> &data) : data_(data)
+    {
+    }
+    bool Next(std::string_view &chunk) override
+    {
+        if (next_ == data_.size())
+        {
+            return false;
+        }
+        chunk = data_[next_++];
+        return true;
+    }
+
+private:
+    const std::vector<std::string> &data_;
+    std::size_t next_ = 0;
+};
+
+class StringSink : public ChunkSink
+{
+public:
+    void Write(std::string_view data) override
+    {
+        result_.append(data.data(), data.size());
+    }
+    std::string &result()
+    {
+        return result_;
+    }
+
+private:
+    std::string result_;
+};
+
+using File = std::unique_ptr<std::FILE, int (*)(std::FILE *)>;
+
+class FileSink : public ChunkSink
+{
+public:
+    explicit FileSink(std::FILE *file) : file_(file)
+    {
+    }
+    void Write(std::string_view data) override
+    {
+        if (std::fwrite(data.data(), 1, data.size(), file_) != data.size())
+        {
+            throw std::runtime_error("ExternalSortStrategy: cannot write a temporary run");
+        }
+    }
+
+private:
+    std::FILE *file_;
+};
+
+struct SpillStats
+{
+    std::size_t runs = 0;
+    std::size_t merge_passes = 0;
+    std::uint64_t bytes_spilled = 0;
+};
+
+/**
+ * ExternalSortStrategy never holds more than |memory_budget| bytes of data.
+ *
+ * Run formation fills a buffer of that size from the source, sorts it and
+ * spills it to an anonymous temporary file (std::tmpfile, removed when it is
+ * closed). If everything fits in one buffer, nothing is spilled.
+ *
+ * Merging reads up to |max_fan_in| runs at once, each through its own slice
+ * of the budget, and repeatedly copies the longest prefix of the smallest
+ * run that does not pass the head of the next one. Intermediate passes merge
+ * groups of runs into longer runs until one pass can write the sink.
+ */
+class ExternalSortStrategy : public Strategy
+{
+public:
+    ExternalSortStrategy(std::size_t memory_budget = std::size_t(64) << 20, std::size_t max_fan_in = 64,
+                         SpillStats *stats = nullptr)
+        : memory_budget_(std::max<std::size_t>(memory_budget, 4096)),
+          max_fan_in_(std::max<std::size_t>(max_fan_in, 2)), stats_(stats)
+    {
+    }
+
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        VectorSource source(data);
+        StringSink sink;
+        DoAlgorithm(source, sink);
+        return std::move(sink.result());
+    }
+
+    void DoAlgorithm(ChunkSource &source, ChunkSink &sink) const override
+    {
+        SpillStats stats;
+        std::vector<Run> runs;
+        std::string buffer;
+        buffer.reserve(memory_budget_);
+        std::string_view chunk;
+        while (source.Next(chunk))
+        {
+            while (!chunk.empty())
+            {
+                std::size_t take = std::min(chunk.size(), memory_budget_ - buffer.size());
+                buffer.append(chunk.data(), take);
+                chunk.remove_prefix(take);
+                if (buffer.size() == memory_budget_)
+                {
+                    runs.push_back(Spill(buffer, stats));
+                }
+            }
+        }
+
+        if (runs.empty())
+        {
+            std::sort(buffer.begin(), buffer.end());
+            sink.Write(buffer);
+            Report(stats);
+            return;
+        }
+        if (!buffer.empty())
+        {
+            runs.push_back(Spill(buffer, stats));
+        }
+        std::string().swap(buffer);
+        stats.runs = runs.size();
+
+        while (runs.size() > max_fan_in_)
+        {
+            std::vector<Run> merged;
+            for (std::size_t first = 0; first < runs.size(); first += max_fan_in_)
+            {
+                std::size_t last = std::min(runs.size(), first + max_fan_in_);
+                if (last - first == 1)
+                {
+                    merged.push_back(std::move(runs[first]));
+                    continue;
+                }
+                Run run{NewFile(), 0};
+                FileSink file_sink(run.file.get());
+                run.size = Merge(runs.begin() + first, runs.begin() + last, file_sink);
+                stats.bytes_spilled += run.size;
+                merged.push_back(std::move(run));
+            }
+            runs = std::move(merged);
+            ++stats.merge_passes;
+        }
+        Merge(runs.begin(), runs.end(), sink);
+        ++stats.merge_passes;
+        Report(stats);
+    }
+
+private:
+    struct Run
+    {
+        File file;
+        std::uint64_t size;
+    };
+
+    // Reads one run back through a fixed buffer.
+    class RunReader
+    {
+    public:
+        RunReader(std::FILE *file, std::size_t buffer_size) : file_(file), buffer_(buffer_size)
+        {
+            std::rewind(file_);
+            Refill();
+        }
+        bool empty() const
+        {
+            return head_ == end_;
+        }
+        const char *head() const
+        {
+            return head_;
+        }
+        const char *end() const
+        {
+            return end_;
+        }
+        void Advance(const char *to)
+        {
+            head_ = to;
+            if (head_ == end_)
+            {
+                Refill();
+            }
+        }
+
+    private:
+        void Refill()
+        {
+            std::size_t read = std::fread(buffer_.data(), 1, buffer_.size(), file_);
+            if (read < buffer_.size() && std::ferror(file_))
+            {
+                throw std::runtime_error("ExternalSortStrategy: cannot read a temporary run");
+            }
+            head_ = buffer_.data();
+            end_ = head_ + read;
+        }
+
+        std::FILE *file_;
+        std::vector<char> buffer_;
+        const char *head_ = nullptr;
+        const char *end_ = nullptr;
+    };
+
+    static File NewFile()
+    {
+        File file(std::tmpfile(), &std::fclose);
+        if (!file)
+        {
+            throw std::runtime_error("ExternalSortStrategy: cannot create a temporary file");
+        }
+        return file;
+    }
+
+    static Run Spill(std::string &buffer, SpillStats &stats)
+    {
+        std::sort(buffer.begin(), buffer.end());
+        Run run{NewFile(), buffer.size()};
+        FileSink(run.file.get()).Write(buffer);
+        stats.bytes_spilled += buffer.size();
+        buffer.clear();
+        return run;
+    }
+
+    std::uint64_t Merge(std::vector<Run>::iterator first, std::vector<Run>::iterator last, ChunkSink &sink) const
+    {
+        std::size_t slice = std::max<std::size_t>(4096, memory_budget_ / (last - first));
+        std::vector<std::unique_ptr<RunReader>> readers;
+        for (std::vector<Run>::iterator run = first; run != last; ++run)
+        {
+            readers.push_back(std::make_unique<RunReader>(run->file.get(), slice));
+        }
+
+        // std::push_heap builds a max-heap, so order by the greater head.
+        auto later = [](const RunReader *a, const RunReader *b) { return *a->head() > *b->head(); };
+        std::vector<RunReader *> heap;
+        for (const std::unique_ptr<RunReader> &reader : readers)
+        {
+            if (!reader->empty())
+            {
+                heap.push_back(reader.get());
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), later);
+
+        std::uint64_t written = 0;
+        while (!heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            RunReader *smallest = heap.back();
+            const char *stop = smallest->end();
+            if (heap.size() > 1)
+            {
+                stop = std::upper_bound(smallest->head(), smallest->end(), *heap.front()->head());
+            }
+            sink.Write(std::string_view(smallest->head(), stop - smallest->head()));
+            written += stop - smallest->head();
+            smallest->Advance(stop);
+            if (smallest->empty())
+            {
+                heap.pop_back();
+            }
+            else
+            {
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+        return written;
+    }
+
+    void Report(const SpillStats &stats) const
+    {
+        if (stats_)
+        {
+            *stats_ = stats;
+        }
+    }
+
+    std::size_t memory_budget_;
+    std::size_t max_fan_in_;
+    SpillStats *stats_;
+};
+
+void ClientCode()
+{
+    std::shared_ptr<Context> context = std::make_shared<Context>(std::make_shared<ConcreteStrategyA>());
+    std::cout << "Client: Strategy is set to normal sorting.\n";
+    context->DoSomeBusinessLogic();
+    std::cout << "\n";
+    std::cout << "Client: Strategy is set to external sorting with a 4 KB budget.\n";
+    context->set_strategy(std::make_shared<ExternalSortStrategy>(4096));
+    context->DoSomeBusinessLogic();
+}
+
+/**
+ * Produces |bytes| of random printable text on the fly, so the input never
+ * exists in memory as a whole.
+ */
+class RandomSource : public ChunkSource
+{
+public:
+    RandomSource(std::uint64_t bytes, std::uint64_t seed) : remaining_(bytes), seed_(seed), chunk_(64 * 1024, '\0')
+    {
+    }
+    bool Next(std::string_view &chunk) override
+    {
+        if (remaining_ == 0)
+        {
+            return false;
+        }
+        std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(chunk_.size(), remaining_));
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            seed_ ^= seed_ << 13;
+            seed_ ^= seed_ >> 7;
+            seed_ ^= seed_ << 17;
+            chunk_[i] = static_cast<char>(' ' + (seed_ >> 32) % 95);
+        }
+        remaining_ -= size;
+        chunk = std::string_view(chunk_.data(), size);
+        return true;
+    }
+
+private:
+    std::uint64_t remaining_;
+    std::uint64_t seed_;
+    std::string chunk_;
+};
+
+/**
+ * Checks that the output arrives in order and keeps a byte histogram to
+ * compare against the input, without storing the output.
+ */
+class VerifyingSink : public ChunkSink
+{
+public:
+    void Write(std::string_view data) override
+    {
+        for (char c : data)
+        {
+            sorted_ = sorted_ && c >= previous_;
+            previous_ = c;
+            ++counts_[static_cast<unsigned char>(c)];
+        }
+        bytes_ += data.size();
+    }
+    bool sorted() const
+    {
+        return sorted_;
+    }
+    std::uint64_t bytes() const
+    {
+        return bytes_;
+    }
+    const std::uint64_t *counts() const
+    {
+        return counts_;
+    }
+
+private:
+    bool sorted_ = true;
+    char previous_ = ' ';
+    std::uint64_t bytes_ = 0;
+    std::uint64_t counts_[256] = {};
+};
+
+int main(int argc, char *argv[])
+{
+    using Clock = std::chrono::steady_clock;
+
+    ClientCode();
+
+    std::uint64_t bytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::uint64_t(128) << 20;
+    std::size_t budget = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::size_t(4) << 20;
+    std::size_t fan_in = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 16;
+    std::cout << "\nBenchmark: " << bytes << " bytes through a " << budget << " byte budget, fan-in " << fan_in
+              << "\n";
+
+    SpillStats stats;
+    Context context(std::make_shared<ExternalSortStrategy>(budget, fan_in, &stats));
+    RandomSource source(bytes, 0x9e3779b97f4a7c15ULL);
+    VerifyingSink sink;
+    Clock::time_point start = Clock::now();
+    context.Sort(source, sink);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Replay the input to check that every byte came out exactly once.
+    RandomSource replay(bytes, 0x9e3779b97f4a7c15ULL);
+    std::uint64_t expected[256] = {};
+    std::string_view chunk;
+    while (replay.Next(chunk))
+    {
+        for (char c : chunk)
+        {
+            ++expected[static_cast<unsigned char>(c)];
+        }
+    }
+    bool complete = std::equal(expected, expected + 256, sink.counts());
+
+    std::cout << "  " << seconds << " s, " << bytes / seconds / 1e6 << " MB/s\n";
+    std::cout << "  " << stats.runs << " runs, " << stats.merge_passes << " merge passes, " << stats.bytes_spilled
+              << " bytes spilled\n";
+    std::cout << "  output " << sink.bytes() << " bytes, " << (sink.sorted() ? "sorted" : "NOT SORTED") << ", "
+              << (complete ? "complete" : "BYTES LOST") << "\n";
+    return 0;
+}
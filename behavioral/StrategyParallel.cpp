@@ -0,0 +1,399 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * The Strategy interface declares operations common to all supported versions
+ * of some algorithm.
+ */
+class Strategy
+{
+public:
+    virtual ~Strategy() {}
+    virtual std::string DoAlgorithm(const std::vector<std::string> &data) const = 0;
+};
+
+class Context
+{
+private:
+    std::shared_ptr<Strategy> strategy_;
+
+public:
+    Context(std::shared_ptr<Strategy> strategy = nullptr) : strategy_(strategy)
+    {
+    }
+    void set_strategy(std::shared_ptr<Strategy> strategy)
+    {
+        this->strategy_ = strategy;
+    }
+    void DoSomeBusinessLogic() const
+    {
+        std::cout << "Context: Sorting data using the strategy (not sure how it'll do it)\n";
+        std::string result = this->strategy_->DoAlgorithm(std::vector<std::string>{"a", "e", "c", "b", "d"});
+        std::cout << result << "\n";
+    }
+};
+
+/**
+ * The sequential strategy of Strategy.cpp, unchanged, as the baseline.
+ */
+class ConcreteStrategyA : public Strategy
+{
+public:
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::string result;
+        std::for_each(std::begin(data), std::end(data), [&result](const std::string &letter) {
+            result += letter;
+        });
+        std::sort(std::begin(result), std::end(result));
+
+        return result;
+    }
+};
+
+/**
+ * A fixed set of worker threads. ParallelFor() runs task(0) .. task(count - 1)
+ * on the workers and the calling thread, which pull indices from a shared
+ * counter, and returns once every index has been processed. One ParallelFor()
+ * runs at a time.
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(std::size_t threads)
+    {
+        for (std::size_t i = 1; i < std::max<std::size_t>(threads, 1); ++i)
+        {
+            workers_.emplace_back(&ThreadPool::Run, this);
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (std::thread &worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    std::size_t size() const
+    {
+        return workers_.size() + 1;
+    }
+
+    void ParallelFor(std::size_t count, const std::function<void(std::size_t)> &task)
+    {
+        std::lock_guard<std::mutex> serial(serial_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = &task;
+            count_ = count;
+            next_.store(0, std::memory_order_relaxed);
+            pending_ = workers_.size();
+            ++generation_;
+        }
+        start_.notify_all();
+        Work();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return pending_ == 0; });
+    }
+
+private:
+    void Run()
+    {
+        std::uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            start_.wait(lock, [this, seen]() { return stop_ || generation_ != seen; });
+            if (stop_)
+            {
+                return;
+            }
+            seen = generation_;
+            lock.unlock();
+            Work();
+            lock.lock();
+            if (--pending_ == 0)
+            {
+                done_.notify_one();
+            }
+        }
+    }
+
+    void Work()
+    {
+        for (std::size_t i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1))
+        {
+            (*task_)(i);
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex serial_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(std::size_t)> *task_ = nullptr;
+    std::size_t count_ = 0;
+    std::atomic<std::size_t> next_{0};
+    std::size_t pending_ = 0;
+    std::uint64_t generation_ = 0;
+    bool stop_ = false;
+};
+
+/**
+ * ParallelSortStrategy produces the same result as ConcreteStrategyA:
+ *
+ * 1. The strings are concatenated and the buffer is cut into one run per
+ *    thread; every run is sorted with std::sort on the pool.
+ * 2. The output is cut into one part per thread. For each part boundary a
+ *    multi-sequence selection finds, in every run, how many of its characters
+ *    fall in front of the boundary, so the parts can be merged independently.
+ * 3. Every part is a k-way merge of its slices of the runs. The merge always
+ *    copies the longest prefix of the smallest run that does not pass the head
+ *    of the next run, so long stretches of equal characters move as one block.
+ */
+class ParallelSortStrategy : public Strategy
+{
+public:
+    explicit ParallelSortStrategy(std::size_t threads = std::thread::hardware_concurrency())
+        : pool_(new ThreadPool(std::max<std::size_t>(threads, 1)))
+    {
+    }
+
+    std::size_t threads() const
+    {
+        return pool_->size();
+    }
+
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        std::string runs;
+        std::for_each(std::begin(data), std::end(data), [&runs](const std::string &letter) {
+            runs += letter;
+        });
+        std::size_t size = runs.size();
+        std::size_t parts = std::max<std::size_t>(1, std::min(pool_->size(), size / kMinRun));
+        if (parts == 1)
+        {
+            std::sort(std::begin(runs), std::end(runs));
+            return runs;
+        }
+
+        std::vector<std::size_t> bounds(parts + 1);
+        for (std::size_t p = 0; p <= parts; ++p)
+        {
+            bounds[p] = size * p / parts;
+        }
+        pool_->ParallelFor(parts, [&runs, &bounds](std::size_t p) {
+            std::sort(runs.begin() + bounds[p], runs.begin() + bounds[p + 1]);
+        });
+
+        // cuts[p][r] is the first character of run r that belongs to output
+        // part p or later.
+        std::vector<std::vector<std::size_t>> cuts(parts + 1);
+        pool_->ParallelFor(parts + 1, [&runs, &bounds, &cuts](std::size_t p) {
+            cuts[p] = Select(runs, bounds, bounds[p]);
+        });
+
+        std::string result(size, '\0');
+        pool_->ParallelFor(parts, [&runs, &cuts, &bounds, &result](std::size_t p) {
+            Merge(runs, cuts[p], cuts[p + 1], &result[bounds[p]]);
+        });
+        return result;
+    }
+
+private:
+    static constexpr std::size_t kMinRun = 1 << 16;
+
+    // Splits the sorted runs so that exactly |rank| characters are in front
+    // of the cut and none of them is greater than any character behind it.
+    static std::vector<std::size_t> Select(const std::string &runs, const std::vector<std::size_t> &bounds,
+                                           std::size_t rank)
+    {
+        std::size_t count = bounds.size() - 1;
+        const char *base = runs.data();
+
+        // The smallest value with at least |rank| characters <= value.
+        int low = CHAR_MIN;
+        int high = CHAR_MAX;
+        while (low < high)
+        {
+            int middle = low + (high - low) / 2;
+            std::size_t at_most = 0;
+            for (std::size_t r = 0; r < count; ++r)
+            {
+                at_most += std::upper_bound(base + bounds[r], base + bounds[r + 1], static_cast<char>(middle)) -
+                           (base + bounds[r]);
+            }
+            if (at_most >= rank)
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1;
+            }
+        }
+
+        // Everything below the value goes in front; the characters equal to
+        // it are handed out run by run until the rank is reached.
+        char value = static_cast<char>(low);
+        std::vector<std::size_t> cut(count);
+        std::size_t taken = 0;
+        for (std::size_t r = 0; r < count; ++r)
+        {
+            cut[r] = std::lower_bound(base + bounds[r], base + bounds[r + 1], value) - base;
+            taken += cut[r] - bounds[r];
+        }
+        for (std::size_t r = 0; r < count && taken < rank; ++r)
+        {
+            std::size_t equal = std::upper_bound(base + cut[r], base + bounds[r + 1], value) - (base + cut[r]);
+            std::size_t extra = std::min(equal, rank - taken);
+            cut[r] += extra;
+            taken += extra;
+        }
+        return cut;
+    }
+
+    static void Merge(const std::string &runs, const std::vector<std::size_t> &from,
+                      const std::vector<std::size_t> &to, char *out)
+    {
+        struct Cursor
+        {
+            const char *head;
+            const char *end;
+        };
+        // std::push_heap builds a max-heap, so order by the greater head.
+        auto later = [](const Cursor &a, const Cursor &b) { return *a.head > *b.head; };
+
+        std::vector<Cursor> heap;
+        for (std::size_t r = 0; r < from.size(); ++r)
+        {
+            if (from[r] < to[r])
+            {
+                heap.push_back(Cursor{runs.data() + from[r], runs.data() + to[r]});
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), later);
+
+        while (!heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            Cursor &smallest = heap.back();
+            const char *stop = smallest.end;
+            if (heap.size() > 1)
+            {
+                stop = std::upper_bound(smallest.head, smallest.end, *heap.front().head);
+            }
+            out = std::copy(smallest.head, stop, out);
+            smallest.head = stop;
+            if (smallest.head == smallest.end)
+            {
+                heap.pop_back();
+            }
+            else
+            {
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+    }
+
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+void ClientCode()
+{
+    std::shared_ptr<Context> context = std::make_shared<Context>(std::make_shared<ConcreteStrategyA>());
+    std::cout << "Client: Strategy is set to normal sorting.\n";
+    context->DoSomeBusinessLogic();
+    std::cout << "\n";
+    std::cout << "Client: Strategy is set to parallel sorting.\n";
+    context->set_strategy(std::make_shared<ParallelSortStrategy>());
+    context->DoSomeBusinessLogic();
+}
+
+/**
+ * Random printable text, split into 64 KB strings.
+ */
+std::vector<std::string> RandomData(std::size_t bytes, std::uint64_t seed)
+{
+    const std::size_t kChunk = 64 * 1024;
+    std::vector<std::string> data;
+    for (std::size_t done = 0; done < bytes; done += kChunk)
+    {
+        std::string chunk(std::min(kChunk, bytes - done), '\0');
+        for (char &c : chunk)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            c = static_cast<char>(' ' + (seed >> 32) % 95);
+        }
+        data.push_back(std::move(chunk));
+    }
+    return data;
+}
+
+double Seconds(const Strategy &strategy, const std::vector<std::string> &data, std::string &result)
+{
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    result = strategy.DoAlgorithm(data);
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    ClientCode();
+
+    std::size_t bytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::size_t(64) << 20;
+    std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> data = RandomData(bytes, 0x9e3779b97f4a7c15ULL);
+
+    std::cout << "\nBenchmark: " << bytes << " bytes, " << cores << " hardware threads\n\n";
+    std::string expected;
+    double baseline_s = Seconds(ConcreteStrategyA(), data, expected);
+    std::cout << std::setw(10) << "threads" << std::setw(12) << "seconds" << std::setw(10) << "speedup" << "\n";
+    std::cout << std::setw(10) << "std::sort" << std::setw(12) << baseline_s << std::setw(9) << 1.0 << "x\n";
+
+    std::vector<std::size_t> thread_counts = {1, 4, 16};
+    if (std::find(thread_counts.begin(), thread_counts.end(), cores) == thread_counts.end())
+    {
+        thread_counts.push_back(cores);
+    }
+    for (std::size_t threads : thread_counts)
+    {
+        ParallelSortStrategy strategy(threads);
+        std::string result;
+        double parallel_s = Seconds(strategy, data, result);
+        std::cout << std::setw(10) << threads << std::setw(12) << parallel_s << std::setw(9) << baseline_s / parallel_s
+                  << "x";
+        if (result != expected)
+        {
+            std::cout << " (mismatch!)";
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
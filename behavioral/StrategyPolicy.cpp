@@ -0,0 +1,254 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <variant>
+
+/**
+ * The two sorting algorithms of Strategy.cpp as plain policy classes: no base
+ * class, no virtual functions, and DoAlgorithm is visible to the compiler at
+ * every call site.
+ */
+struct SortAscending
+{
+    static constexpr const char *kName = "normal sorting";
+
+    std::string DoAlgorithm(const std::vector<std::string> &data) const
+    {
+        std::string result;
+        std::for_each(std::begin(data), std::end(data), [&result](const std::string &letter) {
+            result += letter;
+        });
+        std::sort(std::begin(result), std::end(result));
+
+        return result;
+    }
+};
+
+struct SortDescending
+{
+    static constexpr const char *kName = "reverse sorting";
+
+    std::string DoAlgorithm(const std::vector<std::string> &data) const
+    {
+        std::string result;
+        std::for_each(std::begin(data), std::end(data), [&result](const std::string &letter) {
+            result += letter;
+        });
+        std::sort(std::begin(result), std::end(result));
+        for (std::size_t i = 0; i < result.size() / 2; i++)
+        {
+            std::swap(result[i], result[result.size() - i - 1]);
+        }
+
+        return result;
+    }
+};
+
+/**
+ * The runtime-polymorphic design of Strategy.cpp, kept as the baseline. The
+ * concrete strategies wrap the policies above so that all three dispatch
+ * styles run exactly the same algorithm.
+ */
+class Strategy
+{
+public:
+    virtual ~Strategy() {}
+    virtual std::string DoAlgorithm(const std::vector<std::string> &data) const = 0;
+};
+
+template <typename Policy>
+class StrategyAdapter : public Strategy
+{
+public:
+    std::string DoAlgorithm(const std::vector<std::string> &data) const override
+    {
+        return policy_.DoAlgorithm(data);
+    }
+
+private:
+    Policy policy_;
+};
+
+using ConcreteStrategyA = StrategyAdapter<SortAscending>;
+using ConcreteStrategyB = StrategyAdapter<SortDescending>;
+
+class Context
+{
+private:
+    std::shared_ptr<Strategy> strategy_;
+
+public:
+    Context(std::shared_ptr<Strategy> strategy = nullptr) : strategy_(strategy)
+    {
+    }
+    void set_strategy(std::shared_ptr<Strategy> strategy)
+    {
+        this->strategy_ = strategy;
+    }
+    std::string Sort(const std::vector<std::string> &data) const
+    {
+        return this->strategy_->DoAlgorithm(data);
+    }
+};
+
+/**
+ * PolicyContext fixes the strategy at compile time. The policy is a base
+ * class, so an empty policy costs no storage, and Sort() is an ordinary
+ * inlinable call. Changing the strategy means using another type.
+ */
+template <typename StrategyPolicy>
+class PolicyContext : private StrategyPolicy
+{
+public:
+    PolicyContext(StrategyPolicy policy = StrategyPolicy()) : StrategyPolicy(policy)
+    {
+    }
+    std::string Sort(const std::vector<std::string> &data) const
+    {
+        return StrategyPolicy::DoAlgorithm(data);
+    }
+    void DoSomeBusinessLogic() const
+    {
+        std::cout << "Context: Sorting data using " << StrategyPolicy::kName << "\n";
+        std::string result = Sort(std::vector<std::string>{"a", "e", "c", "b", "d"});
+        std::cout << result << "\n";
+    }
+};
+
+/**
+ * VariantContext can still switch strategies at runtime, but the set of
+ * strategies is closed. The current one is stored inline in a std::variant,
+ * so there is no heap object and no reference count, and std::visit turns
+ * the call into a switch over the alternatives, each of which is inlined.
+ */
+template <typename... Policies>
+class VariantContext
+{
+public:
+    using AnyStrategy = std::variant<Policies...>;
+
+    VariantContext(AnyStrategy strategy = AnyStrategy()) : strategy_(strategy)
+    {
+    }
+    void set_strategy(AnyStrategy strategy)
+    {
+        this->strategy_ = strategy;
+    }
+    std::string Sort(const std::vector<std::string> &data) const
+    {
+        return std::visit([&data](const auto &strategy) { return strategy.DoAlgorithm(data); }, this->strategy_);
+    }
+    void DoSomeBusinessLogic() const
+    {
+        const char *name = std::visit([](const auto &strategy) { return strategy.kName; }, this->strategy_);
+        std::cout << "Context: Sorting data using " << name << "\n";
+        std::string result = Sort(std::vector<std::string>{"a", "e", "c", "b", "d"});
+        std::cout << result << "\n";
+    }
+
+private:
+    AnyStrategy strategy_;
+};
+
+void ClientCode()
+{
+    std::cout << "Client: Strategy is fixed at compile time.\n";
+    PolicyContext<SortAscending> ascending;
+    ascending.DoSomeBusinessLogic();
+    PolicyContext<SortDescending> descending;
+    descending.DoSomeBusinessLogic();
+    std::cout << "\n";
+
+    std::cout << "Client: Strategy is switched at runtime, without the heap.\n";
+    VariantContext<SortAscending, SortDescending> context;
+    context.DoSomeBusinessLogic();
+    context.set_strategy(SortDescending());
+    context.DoSomeBusinessLogic();
+}
+
+/**
+ * Sorts every input |rounds| times and returns nanoseconds per call, best of
+ * three runs. The inputs have 1 to 8 one-letter strings, so the result fits
+ * the small-string buffer and the cost of reaching the algorithm is a visible
+ * share of the total.
+ */
+template <typename ContextT>
+double NanosPerCall(const ContextT &context, const std::vector<std::vector<std::string>> &inputs,
+                    std::size_t rounds, std::size_t &checksum)
+{
+    using Clock = std::chrono::steady_clock;
+    double best = 0;
+    for (int run = 0; run < 3; ++run)
+    {
+        checksum = 0;
+        Clock::time_point start = Clock::now();
+        for (std::size_t round = 0; round < rounds; ++round)
+        {
+            for (const std::vector<std::string> &input : inputs)
+            {
+                checksum += static_cast<unsigned char>(context.Sort(input)[0]);
+            }
+        }
+        double nanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (rounds * inputs.size());
+        best = run == 0 ? nanos : std::min(best, nanos);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    ClientCode();
+
+    std::size_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    std::vector<std::vector<std::string>> inputs;
+    std::uint64_t seed = 0x2545f4914f6cdd1dULL;
+    for (std::size_t i = 0; i < 256; ++i)
+    {
+        std::vector<std::string> input;
+        for (std::size_t letter = 0; letter <= i % 8; ++letter)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            input.push_back(std::string(1, static_cast<char>('a' + seed % 26)));
+        }
+        inputs.push_back(std::move(input));
+    }
+    std::cout << "\nBenchmark: " << rounds * inputs.size() << " calls on 1 to 8 letters\n";
+
+    for (int order = 0; order < 2; ++order)
+    {
+        std::size_t checksums[3] = {};
+        double virtual_ns;
+        double policy_ns;
+        double variant_ns;
+        if (order == 0)
+        {
+            virtual_ns = NanosPerCall(Context(std::make_shared<ConcreteStrategyA>()), inputs, rounds, checksums[0]);
+            policy_ns = NanosPerCall(PolicyContext<SortAscending>(), inputs, rounds, checksums[1]);
+            variant_ns = NanosPerCall(VariantContext<SortAscending, SortDescending>(SortAscending()), inputs, rounds,
+                                      checksums[2]);
+        }
+        else
+        {
+            virtual_ns = NanosPerCall(Context(std::make_shared<ConcreteStrategyB>()), inputs, rounds, checksums[0]);
+            policy_ns = NanosPerCall(PolicyContext<SortDescending>(), inputs, rounds, checksums[1]);
+            variant_ns = NanosPerCall(VariantContext<SortAscending, SortDescending>(SortDescending()), inputs, rounds,
+                                      checksums[2]);
+        }
+        std::cout << "  " << (order == 0 ? SortAscending::kName : SortDescending::kName) << ":\n";
+        std::cout << "    shared_ptr + virtual: " << virtual_ns << " ns/call\n";
+        std::cout << "    compile-time policy : " << policy_ns << " ns/call (" << virtual_ns / policy_ns << "x)\n";
+        std::cout << "    std::variant        : " << variant_ns << " ns/call (" << virtual_ns / variant_ns << "x)\n";
+        if (checksums[0] != checksums[1] || checksums[0] != checksums[2])
+        {
+            std::cout << "    (mismatch!)\n";
+        }
+    }
+    return 0;
+}
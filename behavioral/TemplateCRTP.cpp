@@ -0,0 +1,337 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <tuple>
+#include <typeinfo>
+#include <vector>
+
+/**
+ * The steps of Template.cpp do a little arithmetic on the object's state
+ * instead of printing, so the benchmark measures the cost of reaching them.
+ * With a log stream set they also print the original messages.
+ */
+namespace virtual_dispatch {
+
+class AbstractClass {
+ public:
+  explicit AbstractClass(std::ostream* log = nullptr) : log_(log) {}
+  virtual ~AbstractClass() {}
+
+  void TemplateMethod() const {
+    this->BaseOperation1();
+    this->RequiredOperations1();
+    this->BaseOperation2();
+    this->Hook1();
+    this->RequiredOperation2();
+    this->BaseOperation3();
+    this->Hook2();
+  }
+  std::uint64_t state() const {
+    return state_;
+  }
+
+ protected:
+  void BaseOperation1() const {
+    state_ += 1;
+    Say("AbstractClass says: I am doing the bulk of the work\n");
+  }
+  void BaseOperation2() const {
+    state_ ^= state_ >> 7;
+    Say("AbstractClass says: But I let subclasses override some operations\n");
+  }
+  void BaseOperation3() const {
+    state_ *= 3;
+    Say("AbstractClass says: But I am doing the bulk of the work anyway\n");
+  }
+  virtual void RequiredOperations1() const = 0;
+  virtual void RequiredOperation2() const = 0;
+  virtual void Hook1() const {}
+  virtual void Hook2() const {}
+
+  void Say(const char* message) const {
+    if (log_) {
+      *log_ << message;
+    }
+  }
+
+  mutable std::uint64_t state_ = 0;
+  std::ostream* log_;
+};
+
+class ConcreteClass1 : public AbstractClass {
+ public:
+  using AbstractClass::AbstractClass;
+
+ protected:
+  void RequiredOperations1() const override {
+    state_ += 11;
+    Say("ConcreteClass1 says: Implemented Operation1\n");
+  }
+  void RequiredOperation2() const override {
+    state_ ^= 0x55;
+    Say("ConcreteClass1 says: Implemented Operation2\n");
+  }
+};
+
+class ConcreteClass2 : public AbstractClass {
+ public:
+  using AbstractClass::AbstractClass;
+
+ protected:
+  void RequiredOperations1() const override {
+    state_ += 22;
+    Say("ConcreteClass2 says: Implemented Operation1\n");
+  }
+  void RequiredOperation2() const override {
+    state_ ^= 0xaa;
+    Say("ConcreteClass2 says: Implemented Operation2\n");
+  }
+  void Hook1() const override {
+    state_ += state_ << 1;
+    Say("ConcreteClass2 says: Overridden Hook1\n");
+  }
+};
+
+}  // namespace virtual_dispatch
+
+/**
+ * The same skeleton with the curiously recurring template pattern: the
+ * abstract class knows its concrete class as a template parameter and calls
+ * the steps through a static_cast, so the whole TemplateMethod is resolved
+ * and inlined at compile time. A concrete class "overrides" a step by
+ * declaring a function with the same name; otherwise the default in
+ * AbstractClass is used. There is no vtable, so the objects are smaller too.
+ */
+template <typename Derived>
+class AbstractClass {
+ public:
+  explicit AbstractClass(std::ostream* log = nullptr) : log_(log) {}
+
+  void TemplateMethod() const {
+    this->BaseOperation1();
+    derived().RequiredOperations1();
+    this->BaseOperation2();
+    derived().Hook1();
+    derived().RequiredOperation2();
+    this->BaseOperation3();
+    derived().Hook2();
+  }
+  std::uint64_t state() const {
+    return state_;
+  }
+
+ protected:
+  void BaseOperation1() const {
+    state_ += 1;
+    Say("AbstractClass says: I am doing the bulk of the work\n");
+  }
+  void BaseOperation2() const {
+    state_ ^= state_ >> 7;
+    Say("AbstractClass says: But I let subclasses override some operations\n");
+  }
+  void BaseOperation3() const {
+    state_ *= 3;
+    Say("AbstractClass says: But I am doing the bulk of the work anyway\n");
+  }
+  void Hook1() const {}
+  void Hook2() const {}
+
+  void Say(const char* message) const {
+    if (log_) {
+      *log_ << message;
+    }
+  }
+
+  mutable std::uint64_t state_ = 0;
+  std::ostream* log_;
+
+ private:
+  const Derived& derived() const {
+    return static_cast<const Derived&>(*this);
+  }
+};
+
+class ConcreteClass1 : public AbstractClass<ConcreteClass1> {
+  friend class AbstractClass<ConcreteClass1>;
+
+ public:
+  using AbstractClass::AbstractClass;
+
+ protected:
+  void RequiredOperations1() const {
+    state_ += 11;
+    Say("ConcreteClass1 says: Implemented Operation1\n");
+  }
+  void RequiredOperation2() const {
+    state_ ^= 0x55;
+    Say("ConcreteClass1 says: Implemented Operation2\n");
+  }
+};
+
+class ConcreteClass2 : public AbstractClass<ConcreteClass2> {
+  friend class AbstractClass<ConcreteClass2>;
+
+ public:
+  using AbstractClass::AbstractClass;
+
+ protected:
+  void RequiredOperations1() const {
+    state_ += 22;
+    Say("ConcreteClass2 says: Implemented Operation1\n");
+  }
+  void RequiredOperation2() const {
+    state_ ^= 0xaa;
+    Say("ConcreteClass2 says: Implemented Operation2\n");
+  }
+  void Hook1() const {
+    state_ += state_ << 1;
+    Say("ConcreteClass2 says: Overridden Hook1\n");
+  }
+};
+
+/**
+ * TypeGroupedBatch stores a heterogeneous population as one contiguous
+ * vector per concrete class. RunAll() walks each vector in a tight loop, so
+ * every call site sees exactly one type and the steps inline into it.
+ */
+template <typename... Classes>
+class TypeGroupedBatch {
+ public:
+  template <typename T>
+  void Add(T object) {
+    std::get<std::vector<T>>(groups_).push_back(std::move(object));
+  }
+
+  void RunAll() const {
+    std::apply([](const auto&... group) { (Run(group), ...); }, groups_);
+  }
+
+  // Visits every object, group by group.
+  template <typename Function>
+  void ForEach(Function function) const {
+    std::apply([&function](const auto&... group) {
+      auto visit = [&function](const auto& objects) {
+        for (const auto& object : objects) {
+          function(object);
+        }
+      };
+      (visit(group), ...);
+    }, groups_);
+  }
+
+ private:
+  template <typename T>
+  static void Run(const std::vector<T>& objects) {
+    for (const T& object : objects) {
+      object.TemplateMethod();
+    }
+  }
+
+  std::tuple<std::vector<Classes>...> groups_;
+};
+
+/**
+ * The client code calls the template method to execute the algorithm. With
+ * the static version it is a template too and works with any class that
+ * derives from AbstractClass<Derived>.
+ */
+template <typename Derived>
+void ClientCode(const AbstractClass<Derived>& class_) {
+  // ...
+  class_.TemplateMethod();
+  // ...
+}
+
+/**
+ * Benchmark: |size| objects, a fraction |share2| of them ConcreteClass2, in
+ * random order. Each population runs |passes| times through
+ *   - unique_ptr<AbstractClass> in random order (as in Template.cpp),
+ *   - the same pointers sorted by concrete class,
+ *   - TypeGroupedBatch of the CRTP classes.
+ */
+void RunBenchmark(std::size_t size, double share2, std::size_t passes) {
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<std::unique_ptr<virtual_dispatch::AbstractClass>> mixed;
+  TypeGroupedBatch<ConcreteClass1, ConcreteClass2> batch;
+  std::uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  for (std::size_t i = 0; i < size; ++i) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    if ((seed >> 11) * (1.0 / 9007199254740992.0) < share2) {
+      mixed.push_back(std::make_unique<virtual_dispatch::ConcreteClass2>());
+      batch.Add(ConcreteClass2());
+    } else {
+      mixed.push_back(std::make_unique<virtual_dispatch::ConcreteClass1>());
+      batch.Add(ConcreteClass1());
+    }
+  }
+
+  Clock::time_point start = Clock::now();
+  for (std::size_t pass = 0; pass < passes; ++pass) {
+    for (const std::unique_ptr<virtual_dispatch::AbstractClass>& object : mixed) {
+      object->TemplateMethod();
+    }
+  }
+  double mixed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (size * passes);
+
+  std::vector<const virtual_dispatch::AbstractClass*> sorted;
+  for (const std::unique_ptr<virtual_dispatch::AbstractClass>& object : mixed) {
+    sorted.push_back(object.get());
+  }
+  std::stable_sort(sorted.begin(), sorted.end(), [](const virtual_dispatch::AbstractClass* a,
+                                                    const virtual_dispatch::AbstractClass* b) {
+    return typeid(*a).before(typeid(*b));
+  });
+  start = Clock::now();
+  for (std::size_t pass = 0; pass < passes; ++pass) {
+    for (const virtual_dispatch::AbstractClass* object : sorted) {
+      object->TemplateMethod();
+    }
+  }
+  double sorted_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (size * passes);
+
+  start = Clock::now();
+  for (std::size_t pass = 0; pass < passes; ++pass) {
+    batch.RunAll();
+  }
+  double batch_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (size * passes);
+
+  // The virtual objects ran twice as often (mixed and sorted); after as many
+  // untimed batch passes, the states must add up to the same total.
+  for (std::size_t pass = 0; pass < passes; ++pass) {
+    batch.RunAll();
+  }
+  std::uint64_t virtual_sum = 0;
+  for (const std::unique_ptr<virtual_dispatch::AbstractClass>& object : mixed) {
+    virtual_sum += object->state();
+  }
+  std::uint64_t batch_sum = 0;
+  batch.ForEach([&batch_sum](const auto& object) { batch_sum += object.state(); });
+
+  std::cout << "  " << static_cast<int>(share2 * 100) << "% ConcreteClass2: virtual " << mixed_ns
+            << " ns, virtual sorted by class " << sorted_ns << " ns, CRTP batch " << batch_ns << " ns ("
+            << mixed_ns / batch_ns << "x)" << (virtual_sum == batch_sum ? "" : " (mismatch!)") << "\n";
+}
+
+int main(int argc, char* argv[]) {
+  std::cout << "Same client code can work with different subclasses:\n";
+  ConcreteClass1 concreteClass1(&std::cout);
+  ClientCode(concreteClass1);
+  std::cout << "\n";
+  std::cout << "Same client code can work with different subclasses:\n";
+  ConcreteClass2 concreteClass2(&std::cout);
+  ClientCode(concreteClass2);
+
+  std::size_t size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  std::size_t passes = 2;
+  std::cout << "\nBenchmark: " << size << " objects, ns per TemplateMethod\n";
+  for (double share2 : {0.0, 0.1, 0.5}) {
+    RunBenchmark(size, share2, passes);
+  }
+  return 0;
+}
@@ -0,0 +1,339 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * The steps of TemplateMethod, in the order the skeleton runs them.
+ */
+enum class Step { kBaseOperation1, kRequiredOperations1, kBaseOperation2, kHook1, kRequiredOperation2, kBaseOperation3, kHook2 };
+
+constexpr std::size_t kStepCount = 7;
+constexpr Step kSkeleton[kStepCount] = {Step::kBaseOperation1, Step::kRequiredOperations1, Step::kBaseOperation2,
+                                        Step::kHook1, Step::kRequiredOperation2, Step::kBaseOperation3, Step::kHook2};
+constexpr const char* kStepNames[kStepCount] = {"BaseOperation1", "RequiredOperations1", "BaseOperation2", "Hook1",
+                                                "RequiredOperation2", "BaseOperation3", "Hook2"};
+
+/**
+ * AbstractClass of Template.cpp. The skeleton is now the kSkeleton table and
+ * Perform() runs one step of it, so an executor can run the steps of one
+ * object on different threads as long as it keeps their order.
+ *
+ * Each step burns |work| rounds of arithmetic on the object's own state, to
+ * stand in for real per-step cost; with a log stream set the steps also print
+ * the original messages.
+ */
+class AbstractClass {
+ public:
+  explicit AbstractClass(unsigned work = 0, std::ostream* log = nullptr) : work_(work), log_(log) {}
+  virtual ~AbstractClass() {}
+
+  void TemplateMethod() const {
+    for (Step step : kSkeleton) {
+      Perform(step);
+    }
+  }
+  void Perform(Step step) const {
+    switch (step) {
+      case Step::kBaseOperation1: return this->BaseOperation1();
+      case Step::kRequiredOperations1: return this->RequiredOperations1();
+      case Step::kBaseOperation2: return this->BaseOperation2();
+      case Step::kHook1: return this->Hook1();
+      case Step::kRequiredOperation2: return this->RequiredOperation2();
+      case Step::kBaseOperation3: return this->BaseOperation3();
+      case Step::kHook2: return this->Hook2();
+    }
+  }
+  std::uint64_t state() const {
+    return state_;
+  }
+
+ protected:
+  void BaseOperation1() const {
+    Work(1);
+    Say("AbstractClass says: I am doing the bulk of the work\n");
+  }
+  void BaseOperation2() const {
+    Work(2);
+    Say("AbstractClass says: But I let subclasses override some operations\n");
+  }
+  void BaseOperation3() const {
+    Work(3);
+    Say("AbstractClass says: But I am doing the bulk of the work anyway\n");
+  }
+  virtual void RequiredOperations1() const = 0;
+  virtual void RequiredOperation2() const = 0;
+  virtual void Hook1() const {}
+  virtual void Hook2() const {}
+
+  void Work(std::uint64_t salt) const {
+    std::uint64_t state = state_ + salt;
+    for (unsigned i = 0; i < work_; ++i) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+    }
+    state_ = state;
+  }
+  void Say(const char* message) const {
+    if (log_) {
+      *log_ << message;
+    }
+  }
+
+ private:
+  mutable std::uint64_t state_ = 0x9e3779b97f4a7c15ULL;
+  unsigned work_;
+  std::ostream* log_;
+};
+
+class ConcreteClass1 : public AbstractClass {
+ public:
+  using AbstractClass::AbstractClass;
+
+ protected:
+  void RequiredOperations1() const override {
+    Work(11);
+    Say("ConcreteClass1 says: Implemented Operation1\n");
+  }
+  void RequiredOperation2() const override {
+    Work(12);
+    Say("ConcreteClass1 says: Implemented Operation2\n");
+  }
+};
+
+class ConcreteClass2 : public AbstractClass {
+ public:
+  using AbstractClass::AbstractClass;
+
+ protected:
+  void RequiredOperations1() const override {
+    Work(21);
+    Say("ConcreteClass2 says: Implemented Operation1\n");
+  }
+  void RequiredOperation2() const override {
+    Work(22);
+    Say("ConcreteClass2 says: Implemented Operation2\n");
+  }
+  void Hook1() const override {
+    Work(23);
+    Say("ConcreteClass2 says: Overridden Hook1\n");
+  }
+};
+
+/**
+ * A bounded single-producer, single-consumer ring. The producer owns tail_,
+ * the consumer owns head_, and each only reads the other's index, so a push
+ * or a pop is one relaxed load, one acquire load and one release store.
+ */
+template <typename T>
+class SpscQueue {
+ public:
+  // |capacity| is rounded up to a power of two.
+  explicit SpscQueue(std::size_t capacity) {
+    std::size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    slots_.resize(size);
+    mask_ = size - 1;
+  }
+
+  bool TryPush(T value) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+      return false;
+    }
+    slots_[tail & mask_] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& value) {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = slots_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  void Push(T value) {
+    while (!TryPush(value)) {
+      std::this_thread::yield();
+    }
+  }
+
+  T Pop() {
+    T value;
+    while (!TryPop(value)) {
+      std::this_thread::yield();
+    }
+    return value;
+  }
+
+ private:
+  std::vector<T> slots_;
+  std::size_t mask_ = 0;
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+struct StageMetrics {
+  std::size_t first_step = 0;
+  std::size_t last_step = 0;  // exclusive
+  std::size_t objects = 0;
+  double busy_fraction = 0;  // share of the run the stage spent in its steps
+};
+
+/**
+ * PipelinedExecutor cuts the skeleton into |stages| consecutive groups of
+ * steps and gives every group its own thread. Objects flow from stage to
+ * stage through bounded SPSC queues, so while one stage runs Hook1 on an
+ * object the previous stage can already run BaseOperation2 on the next one.
+ * Each object still sees its steps in skeleton order, one at a time.
+ */
+class PipelinedExecutor {
+ public:
+  explicit PipelinedExecutor(std::size_t stages, std::size_t queue_capacity = 1024)
+      : stages_(std::max<std::size_t>(1, std::min(stages, kStepCount))), queue_capacity_(queue_capacity) {}
+
+  // Returns once every object has left the last stage.
+  void Run(const std::vector<const AbstractClass*>& objects) {
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::unique_ptr<SpscQueue<const AbstractClass*>>> queues;
+    for (std::size_t s = 0; s < stages_; ++s) {
+      queues.emplace_back(new SpscQueue<const AbstractClass*>(queue_capacity_));
+    }
+    metrics_.assign(stages_, StageMetrics());
+    std::vector<Clock::duration> busy(stages_, Clock::duration(0));
+
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t s = 0; s < stages_; ++s) {
+      StageMetrics& metrics = metrics_[s];
+      metrics.first_step = s * kStepCount / stages_;
+      metrics.last_step = (s + 1) * kStepCount / stages_;
+      threads.emplace_back([&queues, &metrics, &busy, s, this]() {
+        SpscQueue<const AbstractClass*>& in = *queues[s];
+        SpscQueue<const AbstractClass*>* out = s + 1 < stages_ ? queues[s + 1].get() : nullptr;
+        // A null pointer marks the end of the stream.
+        for (const AbstractClass* object = in.Pop(); object; object = in.Pop()) {
+          Clock::time_point begin = Clock::now();
+          for (std::size_t step = metrics.first_step; step < metrics.last_step; ++step) {
+            object->Perform(kSkeleton[step]);
+          }
+          busy[s] += Clock::now() - begin;
+          ++metrics.objects;
+          if (out) {
+            out->Push(object);
+          }
+        }
+        if (out) {
+          out->Push(nullptr);
+        }
+      });
+    }
+
+    for (const AbstractClass* object : objects) {
+      queues[0]->Push(object);
+    }
+    queues[0]->Push(nullptr);
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+
+    Clock::duration elapsed = Clock::now() - start;
+    for (std::size_t s = 0; s < stages_; ++s) {
+      metrics_[s].busy_fraction = std::chrono::duration<double>(busy[s]) / elapsed;
+    }
+  }
+
+  const std::vector<StageMetrics>& metrics() const {
+    return metrics_;
+  }
+
+ private:
+  std::size_t stages_;
+  std::size_t queue_capacity_;
+  std::vector<StageMetrics> metrics_;
+};
+
+void ClientCode(const AbstractClass* class_) {
+  // ...
+  PipelinedExecutor executor(kStepCount);
+  executor.Run({class_});
+  // ...
+}
+
+// Alternating ConcreteClass1 and ConcreteClass2 objects.
+std::vector<std::unique_ptr<AbstractClass>> MakePopulation(std::size_t count, unsigned work) {
+  std::vector<std::unique_ptr<AbstractClass>> objects;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (i % 2) {
+      objects.emplace_back(new ConcreteClass2(work));
+    } else {
+      objects.emplace_back(new ConcreteClass1(work));
+    }
+  }
+  return objects;
+}
+
+int main(int argc, char* argv[]) {
+  using Clock = std::chrono::steady_clock;
+
+  std::cout << "Same client code can work with different subclasses, one step per thread:\n";
+  ConcreteClass1 concreteClass1(0, &std::cout);
+  ClientCode(&concreteClass1);
+  std::cout << "\n";
+  std::cout << "Same client code can work with different subclasses, one step per thread:\n";
+  ConcreteClass2 concreteClass2(0, &std::cout);
+  ClientCode(&concreteClass2);
+
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  unsigned work = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+  std::cout << "\nBenchmark: " << count << " objects, " << work << " rounds of work per step, "
+            << std::thread::hardware_concurrency() << " hardware threads\n";
+
+  std::vector<std::unique_ptr<AbstractClass>> reference = MakePopulation(count, work);
+  Clock::time_point start = Clock::now();
+  for (const std::unique_ptr<AbstractClass>& object : reference) {
+    object->TemplateMethod();
+  }
+  double sequential_s = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << "  sequential        : " << count / sequential_s / 1e6 << " M objects/s\n";
+
+  for (std::size_t stages : {std::size_t(2), std::size_t(4), kStepCount}) {
+    std::vector<std::unique_ptr<AbstractClass>> objects = MakePopulation(count, work);
+    std::vector<const AbstractClass*> pointers;
+    for (const std::unique_ptr<AbstractClass>& object : objects) {
+      pointers.push_back(object.get());
+    }
+
+    PipelinedExecutor executor(stages);
+    start = Clock::now();
+    executor.Run(pointers);
+    double pipeline_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    bool same = true;
+    for (std::size_t i = 0; i < count; ++i) {
+      same = same && reference[i]->state() == objects[i]->state();
+    }
+    std::cout << "  " << stages << " stages          : " << count / pipeline_s / 1e6 << " M objects/s ("
+              << sequential_s / pipeline_s << "x)" << (same ? "" : " (mismatch!)") << "\n";
+    for (const StageMetrics& metrics : executor.metrics()) {
+      std::cout << "    " << std::setw(20) << kStepNames[metrics.first_step] << " .. " << std::setw(20)
+                << kStepNames[metrics.last_step - 1] << ": " << std::setw(6) << std::fixed << std::setprecision(1)
+                << metrics.busy_fraction * 100 << "% busy" << std::defaultfloat << std::setprecision(6) << "\n";
+    }
+  }
+  return 0;
+}
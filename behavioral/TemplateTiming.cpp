@@ -0,0 +1,435 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Build with -DTEMPLATE_STEP_TIMING=0 to compile the instrumentation out
+// completely; TemplateMethod is then exactly the one of Template.cpp.
+#ifndef TEMPLATE_STEP_TIMING
+#define TEMPLATE_STEP_TIMING 1
+#endif
+
+constexpr std::size_t kStepCount = 7;
+constexpr const char* kStepNames[kStepCount] = {"BaseOperation1", "RequiredOperations1", "BaseOperation2", "Hook1",
+                                                "RequiredOperation2", "BaseOperation3", "Hook2"};
+
+/**
+ * Per-step call counts and latency histograms, per concrete class.
+ *
+ * Every thread writes its own counter table, allocated on first use and kept
+ * by the registry after the thread exits, so recording is a few plain
+ * increments with no sharing between threads. The counters are atomics only
+ * so that Report() may read them while other threads are still recording;
+ * the owning thread updates them with a relaxed load and store, not a locked
+ * read-modify-write.
+ *
+ * Latencies come from the time stamp counter where there is one, which costs
+ * a few nanoseconds to read, and are kept in power-of-two buckets.
+ */
+namespace step_timing {
+
+constexpr std::size_t kMaxClasses = 16;
+constexpr std::size_t kBuckets = 32;
+
+inline std::uint64_t Ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct StepCounters {
+  std::atomic<std::uint64_t> calls{0};
+  std::atomic<std::uint64_t> ticks{0};
+  std::atomic<std::uint64_t> histogram[kBuckets] = {};
+
+  void Record(std::uint64_t elapsed) {
+    std::size_t bucket = std::min(Log2(elapsed), kBuckets - 1);
+    Bump(calls, 1);
+    Bump(ticks, elapsed);
+    Bump(histogram[bucket], 1);
+  }
+
+ private:
+  static std::size_t Log2(std::uint64_t value) {
+#if defined(__GNUG__)
+    return value ? 63 - __builtin_clzll(value) : 0;
+#else
+    std::size_t log = 0;
+    while (value >>= 1) {
+      ++log;
+    }
+    return log;
+#endif
+  }
+
+  // Only the owning thread writes, so no atomic read-modify-write is needed.
+  static void Bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+  }
+};
+
+struct ThreadCounters {
+  StepCounters steps[kMaxClasses][kStepCount];
+};
+
+class Registry {
+ public:
+  static Registry& Instance() {
+    static Registry registry;
+    return registry;
+  }
+
+  void set_enabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  bool enabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Slot of a concrete class, or -1 once kMaxClasses classes are known.
+  // Classes seen before are found without taking the lock: a slot's type is
+  // written once, before type_count_ is released to cover it.
+  int SlotFor(const std::type_info& type) {
+    std::size_t known = type_count_.load(std::memory_order_acquire);
+    for (std::size_t slot = 0; slot < known; ++slot) {
+      if (types_[slot] == &type) {
+        return static_cast<int>(slot);
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    known = type_count_.load(std::memory_order_relaxed);
+    for (std::size_t slot = 0; slot < known; ++slot) {
+      if (*types_[slot] == type) {
+        return static_cast<int>(slot);
+      }
+    }
+    if (known == kMaxClasses) {
+      return -1;
+    }
+    types_[known] = &type;
+    type_count_.store(known + 1, std::memory_order_release);
+    return static_cast<int>(known);
+  }
+
+  // The calling thread's counters for |slot|.
+  StepCounters* Row(int slot) {
+    thread_local ThreadCounters* local = nullptr;
+    if (!local) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      threads_.emplace_back(new ThreadCounters);
+      local = threads_.back().get();
+    }
+    return local->steps[slot];
+  }
+
+  void Report(std::ostream& out) {
+    // The first call calibrates for 20 ms; keep that out of the lock.
+    double nanos_per_tick = NanosPerTick();
+    std::lock_guard<std::mutex> lock(mutex_);
+    out << std::setw(16) << "class" << std::setw(20) << "step" << std::setw(12) << "calls" << std::setw(10)
+        << "mean ns" << std::setw(10) << "p50 ns" << std::setw(10) << "p99 ns" << std::setw(9) << "share" << "\n";
+    std::size_t known = type_count_.load(std::memory_order_relaxed);
+    for (std::size_t slot = 0; slot < known; ++slot) {
+      std::uint64_t calls[kStepCount] = {};
+      std::uint64_t ticks[kStepCount] = {};
+      std::uint64_t histogram[kStepCount][kBuckets] = {};
+      std::uint64_t class_ticks = 0;
+      for (const std::unique_ptr<ThreadCounters>& thread : threads_) {
+        for (std::size_t step = 0; step < kStepCount; ++step) {
+          const StepCounters& counters = thread->steps[slot][step];
+          calls[step] += counters.calls.load(std::memory_order_relaxed);
+          ticks[step] += counters.ticks.load(std::memory_order_relaxed);
+          for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+            histogram[step][bucket] += counters.histogram[bucket].load(std::memory_order_relaxed);
+          }
+        }
+      }
+      for (std::size_t step = 0; step < kStepCount; ++step) {
+        class_ticks += ticks[step];
+      }
+      for (std::size_t step = 0; step < kStepCount; ++step) {
+        if (calls[step] == 0) {
+          continue;
+        }
+        out << std::setw(16) << Name(*types_[slot]) << std::setw(20) << kStepNames[step] << std::setw(12)
+            << calls[step] << std::fixed << std::setprecision(1) << std::setw(10)
+            << ticks[step] * nanos_per_tick / calls[step] << std::setw(10)
+            << Percentile(histogram[step], calls[step], 0.5) * nanos_per_tick << std::setw(10)
+            << Percentile(histogram[step], calls[step], 0.99) * nanos_per_tick << std::setw(8)
+            << (class_ticks ? 100.0 * ticks[step] / class_ticks : 0.0) << "%" << std::defaultfloat
+            << std::setprecision(6) << "\n";
+      }
+    }
+  }
+
+ private:
+  Registry() = default;
+
+  // Upper bound of the bucket that holds the |fraction| quantile.
+  static double Percentile(const std::uint64_t (&histogram)[kBuckets], std::uint64_t calls, double fraction) {
+    std::uint64_t wanted = static_cast<std::uint64_t>(calls * fraction);
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+      seen += histogram[bucket];
+      if (seen > wanted) {
+        return static_cast<double>(std::uint64_t(2) << bucket);
+      }
+    }
+    return static_cast<double>(std::uint64_t(1) << kBuckets);
+  }
+
+  // Measured once against steady_clock.
+  static double NanosPerTick() {
+    static const double value = []() {
+      using Clock = std::chrono::steady_clock;
+      Clock::time_point start = Clock::now();
+      std::uint64_t first = Ticks();
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      std::uint64_t last = Ticks();
+      return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (last - first);
+    }();
+    return value;
+  }
+
+  static std::string Name(const std::type_info& type) {
+#if defined(__GNUG__)
+    int status = 0;
+    std::unique_ptr<char, void (*)(void*)> demangled(abi::__cxa_demangle(type.name(), nullptr, nullptr, &status),
+                                                     std::free);
+    if (status == 0) {
+      return demangled.get();
+    }
+#endif
+    return type.name();
+  }
+
+  std::atomic<bool> enabled_{false};
+  std::mutex mutex_;
+  const std::type_info* types_[kMaxClasses] = {};
+  std::atomic<std::size_t> type_count_{0};
+  std::vector<std::unique_ptr<ThreadCounters>> threads_;
+};
+
+}  // namespace step_timing
+
+/**
+ * AbstractClass of Template.cpp with the instrumentation hooked into the
+ * template method. Subclasses are unchanged: the class is identified through
+ * typeid and looked up in the registry, which is lock-free once the class
+ * is known. The steps do a little arithmetic instead of printing unless
+ * a log stream is given.
+ */
+class AbstractClass {
+ public:
+  explicit AbstractClass(std::ostream* log = nullptr) : log_(log) {}
+  virtual ~AbstractClass() {}
+
+  void TemplateMethod() const {
+#if TEMPLATE_STEP_TIMING
+    if (step_timing::Registry::Instance().enabled()) {
+      TimedTemplateMethod();
+      return;
+    }
+#endif
+    this->BaseOperation1();
+    this->RequiredOperations1();
+    this->BaseOperation2();
+    this->Hook1();
+    this->RequiredOperation2();
+    this->BaseOperation3();
+    this->Hook2();
+  }
+  std::uint64_t state() const {
+    return state_;
+  }
+
+ protected:
+  void BaseOperation1() const {
+    Work(4);
+    Say("AbstractClass says: I am doing the bulk of the work\n");
+  }
+  void BaseOperation2() const {
+    Work(4);
+    Say("AbstractClass says: But I let subclasses override some operations\n");
+  }
+  void BaseOperation3() const {
+    Work(4);
+    Say("AbstractClass says: But I am doing the bulk of the work anyway\n");
+  }
+  virtual void RequiredOperations1() const = 0;
+  virtual void RequiredOperation2() const = 0;
+  virtual void Hook1() const {}
+  virtual void Hook2() const {}
+
+  void Work(unsigned rounds) const {
+    for (unsigned i = 0; i < rounds; ++i) {
+      state_ ^= state_ << 13;
+      state_ ^= state_ >> 7;
+      state_ ^= state_ << 17;
+    }
+  }
+  void Say(const char* message) const {
+    if (log_) {
+      *log_ << message;
+    }
+  }
+
+ private:
+#if TEMPLATE_STEP_TIMING
+  void TimedTemplateMethod() const {
+    int slot = step_timing::Registry::Instance().SlotFor(typeid(*this));
+    if (slot < 0) {
+      TemplateMethodUntimed();
+      return;
+    }
+    step_timing::StepCounters* row = step_timing::Registry::Instance().Row(slot);
+    std::uint64_t t0 = step_timing::Ticks();
+    this->BaseOperation1();
+    std::uint64_t t1 = step_timing::Ticks();
+    this->RequiredOperations1();
+    std::uint64_t t2 = step_timing::Ticks();
+    this->BaseOperation2();
+    std::uint64_t t3 = step_timing::Ticks();
+    this->Hook1();
+    std::uint64_t t4 = step_timing::Ticks();
+    this->RequiredOperation2();
+    std::uint64_t t5 = step_timing::Ticks();
+    this->BaseOperation3();
+    std::uint64_t t6 = step_timing::Ticks();
+    this->Hook2();
+    std::uint64_t t7 = step_timing::Ticks();
+    row[0].Record(t1 - t0);
+    row[1].Record(t2 - t1);
+    row[2].Record(t3 - t2);
+    row[3].Record(t4 - t3);
+    row[4].Record(t5 - t4);
+    row[5].Record(t6 - t5);
+    row[6].Record(t7 - t6);
+  }
+  void TemplateMethodUntimed() const {
+    this->BaseOperation1();
+    this->RequiredOperations1();
+    this->BaseOperation2();
+    this->Hook1();
+    this->RequiredOperation2();
+    this->BaseOperation3();
+    this->Hook2();
+  }
+#endif
+
+ protected:
+  mutable std::uint64_t state_ = 0x9e3779b97f4a7c15ULL;
+
+ private:
+  std::ostream* log_;
+};
+
+class ConcreteClass1 : public AbstractClass {
+ public:
+  using AbstractClass::AbstractClass;
+
+ protected:
+  void RequiredOperations1() const override {
+    Work(8);
+    Say("ConcreteClass1 says: Implemented Operation1\n");
+  }
+  void RequiredOperation2() const override {
+    Work(8);
+    Say("ConcreteClass1 says: Implemented Operation2\n");
+  }
+};
+
+/**
+ * This Hook1 is the expensive step the report should point at: it usually
+ * costs a little, but every 64th call does a lot more.
+ */
+class ConcreteClass2 : public AbstractClass {
+ public:
+  using AbstractClass::AbstractClass;
+
+ protected:
+  void RequiredOperations1() const override {
+    Work(8);
+    Say("ConcreteClass2 says: Implemented Operation1\n");
+  }
+  void RequiredOperation2() const override {
+    Work(8);
+    Say("ConcreteClass2 says: Implemented Operation2\n");
+  }
+  void Hook1() const override {
+    Work(++calls_ % 64 == 0 ? 4096 : 32);
+    Say("ConcreteClass2 says: Overridden Hook1\n");
+  }
+
+ private:
+  mutable std::uint64_t calls_ = 0;
+};
+
+void ClientCode(const AbstractClass& class_) {
+  // ...
+  class_.TemplateMethod();
+  // ...
+}
+
+int main(int argc, char* argv[]) {
+  using Clock = std::chrono::steady_clock;
+
+  std::cout << "Same client code can work with different subclasses:\n";
+  ClientCode(ConcreteClass1(&std::cout));
+  std::cout << "\n";
+  std::cout << "Same client code can work with different subclasses:\n";
+  ClientCode(ConcreteClass2(&std::cout));
+
+  std::size_t calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+  std::size_t threads = 4;
+  std::cout << "\nBenchmark: " << calls << " TemplateMethod calls on ConcreteClass1, ns per call\n";
+
+  std::unique_ptr<AbstractClass> object(new ConcreteClass1);
+  for (bool enabled : {false, true}) {
+    step_timing::Registry::Instance().set_enabled(enabled);
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < calls; ++i) {
+      ClientCode(*object);
+    }
+    double nanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+    std::cout << (enabled ? "  timing enabled : " : "  timing disabled: ") << nanos << " (state "
+              << object->state() % 1000 << ")\n";
+  }
+
+  // A mixed population on several threads; each records into its own table.
+  std::cout << "\nStep report, " << threads << " threads with a mixed population:\n";
+  std::vector<std::thread> pool;
+  for (std::size_t t = 0; t < threads; ++t) {
+    pool.emplace_back([calls, threads]() {
+      ConcreteClass1 first;
+      ConcreteClass2 second;
+      for (std::size_t i = 0; i < calls / threads; ++i) {
+        ClientCode(i % 2 ? static_cast<const AbstractClass&>(second) : first);
+      }
+    });
+  }
+  for (std::thread& thread : pool) {
+    thread.join();
+  }
+  step_timing::Registry::Instance().Report(std::cout);
+  std::cout << "(ConcreteClass1 also includes the single-threaded benchmark above.)\n";
+  return 0;
+}
@@ -0,0 +1,396 @@
+#include <iostream>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * An acyclic version of Visitor.cpp. There is no Visitor interface listing the
+ * concrete components. Instead every component class gets a dense type ID when
+ * it is first used, and every visitor owns a flat table of handlers indexed by
+ * that ID. Visiting a component is one load of its ID, one indexed load from
+ * the table and one indirect call. A new component class, even one that only
+ * exists at runtime, needs no change to the existing visitors: their table
+ * entry for it is a no-op until they register a handler.
+ */
+using TypeId = std::uint32_t;
+
+class TypeRegistry {
+ public:
+  // The handler tables have this many entries.
+  static constexpr std::size_t kMaxTypes = 64;
+
+  // Hands out the next free ID. Thread-safe.
+  static TypeId Register(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex());
+    std::vector<std::string>& all = names();
+    if (all.size() == kMaxTypes) {
+      throw std::length_error("TypeRegistry: more than kMaxTypes component types");
+    }
+    all.push_back(name);
+    count().store(all.size(), std::memory_order_release);
+    return static_cast<TypeId>(all.size() - 1);
+  }
+  static std::string Name(TypeId id) {
+    std::lock_guard<std::mutex> lock(mutex());
+    return names().at(id);
+  }
+  static std::size_t size() {
+    return count().load(std::memory_order_acquire);
+  }
+
+ private:
+  static std::mutex& mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+  static std::vector<std::string>& names() {
+    static std::vector<std::string> names;
+    return names;
+  }
+  static std::atomic<std::size_t>& count() {
+    static std::atomic<std::size_t> count{0};
+    return count;
+  }
+};
+
+/**
+ * The Component only stores its type ID; it needs no Accept() of its own. The
+ * ID must come from TypeRegistry, so that it always indexes a handler table.
+ */
+class Component {
+ public:
+  explicit Component(TypeId type_id) : type_id_(type_id) {
+    if (type_id >= TypeRegistry::size()) {
+      throw std::out_of_range("Component: type ID was not registered");
+    }
+  }
+  virtual ~Component() {}
+  TypeId type_id() const {
+    return type_id_;
+  }
+
+ private:
+  TypeId type_id_;
+};
+
+/**
+ * Concrete Components register themselves on first use through Id().
+ */
+class ConcreteComponentA : public Component {
+ public:
+  explicit ConcreteComponentA(int value = 1) : Component(Id()), value_(value) {}
+  static TypeId Id() {
+    static const TypeId id = TypeRegistry::Register("ConcreteComponentA");
+    return id;
+  }
+  std::string ExclusiveMethodOfConcreteComponentA() const {
+    return "A";
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+class ConcreteComponentB : public Component {
+ public:
+  explicit ConcreteComponentB(int value = 1) : Component(Id()), value_(value) {}
+  static TypeId Id() {
+    static const TypeId id = TypeRegistry::Register("ConcreteComponentB");
+    return id;
+  }
+  std::string SpecialMethodOfConcreteComponentB() const {
+    return "B";
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+template <typename Method>
+struct VisitMethodTraits;
+
+template <typename VisitorT, typename ComponentT>
+struct VisitMethodTraits<void (VisitorT::*)(const ComponentT&)> {
+  using Visitor = VisitorT;
+  using Component = ComponentT;
+};
+
+template <typename VisitorT, typename ComponentT>
+struct VisitMethodTraits<void (VisitorT::*)(const ComponentT&) const> {
+  using Visitor = VisitorT;
+  using Component = ComponentT;
+};
+
+/**
+ * The Visitor base class holds the handler table. Handle(id, handler)
+ * installs a handler for any registered type, including one that has no C++
+ * class of its own.
+ */
+class Visitor {
+ public:
+  using Handler = void (*)(Visitor& visitor, const Component& element);
+
+  Visitor() {
+    table_.fill(&Ignore);
+  }
+  virtual ~Visitor() {}
+
+  void Visit(const Component& element) {
+    table_[element.type_id()](*this, element);
+  }
+
+  void Handle(TypeId id, Handler handler) {
+    table_.at(id) = handler ? handler : &Ignore;
+  }
+
+ private:
+  static void Ignore(Visitor&, const Component&) {}
+
+  std::array<Handler, TypeRegistry::kMaxTypes> table_;
+};
+
+/**
+ * VisitorOf<Self> is the base of concrete visitors. Their constructors call
+ * Handle<&Self::Method>(), which stores a small thunk that casts the visitor
+ * and the component back to their concrete types and calls Method. The casts
+ * are unchecked at runtime, so they are made safe at compile time: Method must
+ * be a member of Self, and only Self can construct a VisitorOf<Self>.
+ */
+template <typename Self>
+class VisitorOf : public Visitor {
+ public:
+  using Visitor::Handle;
+
+ protected:
+  template <auto Method>
+  void Handle() {
+    using Traits = VisitMethodTraits<decltype(Method)>;
+    static_assert(std::is_same<Self, typename Traits::Visitor>::value, "a visitor may only register its own methods");
+    static_assert(std::is_base_of<Component, typename Traits::Component>::value, "Method must take a Component");
+    Visitor::Handle(Traits::Component::Id(), [](Visitor& visitor, const Component& element) {
+      (static_cast<Self&>(visitor).*Method)(static_cast<const typename Traits::Component&>(element));
+    });
+  }
+
+ private:
+  friend Self;
+  VisitorOf() = default;
+};
+
+class ConcreteVisitor1 : public VisitorOf<ConcreteVisitor1> {
+ public:
+  ConcreteVisitor1() {
+    Handle<&ConcreteVisitor1::VisitConcreteComponentA>();
+    Handle<&ConcreteVisitor1::VisitConcreteComponentB>();
+  }
+  void VisitConcreteComponentA(const ConcreteComponentA& element) const {
+    std::cout << element.ExclusiveMethodOfConcreteComponentA() << " + ConcreteVisitor1\n";
+  }
+  void VisitConcreteComponentB(const ConcreteComponentB& element) const {
+    std::cout << element.SpecialMethodOfConcreteComponentB() << " + ConcreteVisitor1\n";
+  }
+};
+
+// Knows only ConcreteComponentA and ignores everything else.
+class ConcreteVisitor2 : public VisitorOf<ConcreteVisitor2> {
+ public:
+  ConcreteVisitor2() {
+    Handle<&ConcreteVisitor2::VisitConcreteComponentA>();
+  }
+  void VisitConcreteComponentA(const ConcreteComponentA& element) const {
+    std::cout << element.ExclusiveMethodOfConcreteComponentA() << " + ConcreteVisitor2\n";
+  }
+};
+
+// Weighted sum of the component values, used by the benchmark.
+class SumVisitor : public VisitorOf<SumVisitor> {
+ public:
+  SumVisitor() {
+    Handle<&SumVisitor::VisitConcreteComponentA>();
+    Handle<&SumVisitor::VisitConcreteComponentB>();
+  }
+  void VisitConcreteComponentA(const ConcreteComponentA& element) {
+    sum_ += element.value();
+  }
+  void VisitConcreteComponentB(const ConcreteComponentB& element) {
+    sum_ += 3 * element.value();
+  }
+  std::int64_t sum() const {
+    return sum_;
+  }
+
+ private:
+  std::int64_t sum_ = 0;
+};
+
+/**
+ * A component type added at runtime, e.g. by a plugin: it has a name and an
+ * ID, but no class of its own and no Id() to call.
+ */
+class DynamicComponent : public Component {
+ public:
+  DynamicComponent(TypeId type_id, std::string payload) : Component(type_id), payload_(std::move(payload)) {}
+  const std::string& payload() const {
+    return payload_;
+  }
+
+ private:
+  std::string payload_;
+};
+
+void ClientCode(const std::vector<std::unique_ptr<Component>>& components, Visitor& visitor) {
+  // ...
+  for (const std::unique_ptr<Component>& comp : components) {
+    visitor.Visit(*comp);
+  }
+  // ...
+}
+
+/**
+ * The double-dispatch design of Visitor.cpp with the same SumVisitor, kept for
+ * the benchmark.
+ */
+namespace classic {
+
+class ConcreteComponentA;
+class ConcreteComponentB;
+
+class Visitor {
+ public:
+  virtual ~Visitor() {}
+  virtual void VisitConcreteComponentA(std::shared_ptr<ConcreteComponentA> element) = 0;
+  virtual void VisitConcreteComponentB(std::shared_ptr<ConcreteComponentB> element) = 0;
+};
+
+class Component {
+ public:
+  virtual ~Component() {}
+  virtual void Accept(std::shared_ptr<Visitor> visitor) = 0;
+};
+
+class ConcreteComponentA : public Component, public std::enable_shared_from_this<ConcreteComponentA> {
+ public:
+  explicit ConcreteComponentA(int value = 1) : value_(value) {}
+  void Accept(std::shared_ptr<Visitor> visitor) override {
+    visitor->VisitConcreteComponentA(shared_from_this());
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+class ConcreteComponentB : public Component, public std::enable_shared_from_this<ConcreteComponentB> {
+ public:
+  explicit ConcreteComponentB(int value = 1) : value_(value) {}
+  void Accept(std::shared_ptr<Visitor> visitor) override {
+    visitor->VisitConcreteComponentB(shared_from_this());
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+class SumVisitor : public Visitor {
+ public:
+  void VisitConcreteComponentA(std::shared_ptr<ConcreteComponentA> element) override {
+    sum_ += element->value();
+  }
+  void VisitConcreteComponentB(std::shared_ptr<ConcreteComponentB> element) override {
+    sum_ += 3 * element->value();
+  }
+  std::int64_t sum() const {
+    return sum_;
+  }
+
+ private:
+  std::int64_t sum_ = 0;
+};
+
+}  // namespace classic
+
+int main(int argc, char* argv[]) {
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<std::unique_ptr<Component>> components;
+  components.emplace_back(new ConcreteComponentA());
+  components.emplace_back(new ConcreteComponentB());
+  std::cout << "The client code works with all visitors through their handler tables:\n";
+  ConcreteVisitor1 visitor1;
+  ClientCode(components, visitor1);
+  std::cout << "\n";
+  std::cout << "A visitor only handles the components it knows:\n";
+  ConcreteVisitor2 visitor2;
+  ClientCode(components, visitor2);
+
+  std::cout << "\n";
+  std::cout << "A component type registered at runtime reaches only the visitors that handle it:\n";
+  TypeId plugin = TypeRegistry::Register("PluginComponent");
+  components.emplace_back(new DynamicComponent(plugin, "C"));
+  visitor1.Handle(plugin, [](Visitor&, const Component& element) {
+    std::cout << static_cast<const DynamicComponent&>(element).payload() << " + ConcreteVisitor1 ("
+              << TypeRegistry::Name(element.type_id()) << ")\n";
+  });
+  ClientCode(components, visitor1);
+  ClientCode(components, visitor2);
+
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  std::cout << "\nBenchmark: " << count << " components, random mix of A and B\n";
+
+  std::vector<std::unique_ptr<Component>> population;
+  std::vector<std::shared_ptr<classic::Component>> pointers;
+  population.reserve(count);
+  pointers.reserve(count);
+  std::uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  for (std::size_t i = 0; i < count; ++i) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    int value = static_cast<int>(seed >> 60);
+    if (seed & 1) {
+      population.emplace_back(new ConcreteComponentA(value));
+      pointers.push_back(std::make_shared<classic::ConcreteComponentA>(value));
+    } else {
+      population.emplace_back(new ConcreteComponentB(value));
+      pointers.push_back(std::make_shared<classic::ConcreteComponentB>(value));
+    }
+  }
+
+  std::shared_ptr<classic::SumVisitor> classic_visitor = std::make_shared<classic::SumVisitor>();
+  Clock::time_point start = Clock::now();
+  for (const std::shared_ptr<classic::Component>& comp : pointers) {
+    comp->Accept(classic_visitor);
+  }
+  double classic_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  SumVisitor table_visitor;
+  start = Clock::now();
+  ClientCode(population, table_visitor);
+  double table_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  std::cout << "  double dispatch + shared_ptr: " << classic_ms << " ms (sum " << classic_visitor->sum() << ")\n";
+  std::cout << "  type ID handler table       : " << table_ms << " ms (sum " << table_visitor.sum() << ")"
+            << (table_visitor.sum() == classic_visitor->sum() ? "" : " (mismatch!)") << "\n";
+  std::cout << "  speedup                     : " << classic_ms / table_ms << "x, " << TypeRegistry::size()
+            << " registered types\n";
+  return 0;
+}
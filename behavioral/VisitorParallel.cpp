@@ -0,0 +1,215 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * The Visitor Interface and components of Visitor.cpp. The components carry a
+ * value so the benchmark visitors have something to compute.
+ */
+class ConcreteComponentA;
+class ConcreteComponentB;
+
+class Visitor {
+ public:
+  virtual ~Visitor() {}
+  virtual void VisitConcreteComponentA(std::shared_ptr<ConcreteComponentA> element) = 0;
+  virtual void VisitConcreteComponentB(std::shared_ptr<ConcreteComponentB> element) = 0;
+};
+
+class Component {
+ public:
+  virtual ~Component() {}
+  virtual void Accept(std::shared_ptr<Visitor> visitor) = 0;
+};
+
+class ConcreteComponentA : public Component, public std::enable_shared_from_this<ConcreteComponentA> {
+ public:
+  explicit ConcreteComponentA(int value = 1) : value_(value) {}
+  void Accept(std::shared_ptr<Visitor> visitor) override {
+    visitor->VisitConcreteComponentA(shared_from_this());
+  }
+  std::string ExclusiveMethodOfConcreteComponentA() {
+    return "A";
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+class ConcreteComponentB : public Component, public std::enable_shared_from_this<ConcreteComponentB> {
+ public:
+  explicit ConcreteComponentB(int value = 1) : value_(value) {}
+  void Accept(std::shared_ptr<Visitor> visitor) override {
+    visitor->VisitConcreteComponentB(shared_from_this());
+  }
+  std::string SpecialMethodOfConcreteComponentB() {
+    return "B";
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+/**
+ * ConcreteVisitor1 collects its lines instead of printing them, so several
+ * instances can run at once and their output can be merged afterwards.
+ */
+class ConcreteVisitor1 : public Visitor {
+ public:
+  void VisitConcreteComponentA(std::shared_ptr<ConcreteComponentA> element) override {
+    lines_.push_back(element->ExclusiveMethodOfConcreteComponentA() + " + ConcreteVisitor1");
+  }
+  void VisitConcreteComponentB(std::shared_ptr<ConcreteComponentB> element) override {
+    lines_.push_back(element->SpecialMethodOfConcreteComponentB() + " + ConcreteVisitor1");
+  }
+  // Appends the lines of |other| after this visitor's own.
+  void Merge(const ConcreteVisitor1& other) {
+    lines_.insert(lines_.end(), other.lines_.begin(), other.lines_.end());
+  }
+  const std::vector<std::string>& lines() const {
+    return lines_;
+  }
+
+ private:
+  std::vector<std::string> lines_;
+};
+
+// Weighted sum of the component values, used by the benchmark.
+class SumVisitor : public Visitor {
+ public:
+  void VisitConcreteComponentA(std::shared_ptr<ConcreteComponentA> element) override {
+    sum_ += element->value();
+  }
+  void VisitConcreteComponentB(std::shared_ptr<ConcreteComponentB> element) override {
+    sum_ += 3 * element->value();
+  }
+  void Merge(const SumVisitor& other) {
+    sum_ += other.sum_;
+  }
+  std::int64_t sum() const {
+    return sum_;
+  }
+
+ private:
+  std::int64_t sum_ = 0;
+};
+
+void ClientCode(const std::vector<std::shared_ptr<Component>>& components, std::shared_ptr<Visitor> visitor) {
+  // ...
+  for (const std::shared_ptr<Component>& comp : components) {
+    comp->Accept(visitor);
+  }
+  // ...
+}
+
+/**
+ * ParallelClientCode is the map-reduce form of ClientCode. The components are
+ * cut into |workers| consecutive chunks; each worker gets a fresh visitor from
+ * |make_visitor| and runs it over its chunk (map). Afterwards
+ * reduce(total, part) folds the visitors of chunks 1 .. workers - 1 into the
+ * visitor of chunk 0, in chunk order, which is returned (reduce).
+ *
+ * A visitor instance is only ever touched by one thread, so visitors need no
+ * locking. Because the fold keeps chunk order, an associative reduce gives
+ * the same result as ClientCode, even when it is not commutative.
+ */
+template <typename VisitorT, typename MakeVisitor, typename Reduce>
+std::shared_ptr<VisitorT> ParallelClientCode(const std::vector<std::shared_ptr<Component>>& components,
+                                             std::size_t workers, MakeVisitor make_visitor, Reduce reduce) {
+  workers = std::max<std::size_t>(1, std::min(workers, components.size()));
+  std::vector<std::shared_ptr<VisitorT>> visitors;
+  for (std::size_t w = 0; w < workers; ++w) {
+    visitors.push_back(make_visitor());
+  }
+
+  auto map = [&components, &visitors, workers](std::size_t w) {
+    std::size_t begin = w * components.size() / workers;
+    std::size_t end = (w + 1) * components.size() / workers;
+    std::shared_ptr<Visitor> visitor = visitors[w];
+    for (std::size_t i = begin; i < end; ++i) {
+      components[i]->Accept(visitor);
+    }
+  };
+  // The calling thread takes chunk 0.
+  std::vector<std::thread> threads;
+  for (std::size_t w = 1; w < workers; ++w) {
+    threads.emplace_back(map, w);
+  }
+  map(0);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (std::size_t w = 1; w < workers; ++w) {
+    reduce(*visitors[0], *visitors[w]);
+  }
+  return visitors[0];
+}
+
+int main(int argc, char* argv[]) {
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<std::shared_ptr<Component>> components;
+  for (int i = 0; i < 6; ++i) {
+    if (i % 3 == 2) {
+      components.push_back(std::make_shared<ConcreteComponentB>());
+    } else {
+      components.push_back(std::make_shared<ConcreteComponentA>());
+    }
+  }
+  std::cout << "The client code runs one ConcreteVisitor1 per worker and merges them in order:\n";
+  std::shared_ptr<ConcreteVisitor1> visitor1 = ParallelClientCode<ConcreteVisitor1>(
+      components, 3, [] { return std::make_shared<ConcreteVisitor1>(); },
+      [](ConcreteVisitor1& total, const ConcreteVisitor1& part) { total.Merge(part); });
+  for (const std::string& line : visitor1->lines()) {
+    std::cout << line << "\n";
+  }
+
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  std::cout << "\nBenchmark: " << count << " components, random mix of A and B, "
+            << std::thread::hardware_concurrency() << " hardware threads\n";
+
+  std::vector<std::shared_ptr<Component>> population;
+  population.reserve(count);
+  std::uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  for (std::size_t i = 0; i < count; ++i) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    int value = static_cast<int>(seed >> 60);
+    if (seed & 1) {
+      population.push_back(std::make_shared<ConcreteComponentA>(value));
+    } else {
+      population.push_back(std::make_shared<ConcreteComponentB>(value));
+    }
+  }
+
+  std::shared_ptr<SumVisitor> sequential = std::make_shared<SumVisitor>();
+  Clock::time_point start = Clock::now();
+  ClientCode(population, sequential);
+  double sequential_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  std::cout << "  ClientCode          : " << sequential_ms << " ms (sum " << sequential->sum() << ")\n";
+
+  for (std::size_t workers : {1, 2, 4, 8}) {
+    start = Clock::now();
+    std::shared_ptr<SumVisitor> total = ParallelClientCode<SumVisitor>(
+        population, workers, [] { return std::make_shared<SumVisitor>(); },
+        [](SumVisitor& total, const SumVisitor& part) { total.Merge(part); });
+    double parallel_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << "  " << workers << " worker(s)         : " << parallel_ms << " ms (" << sequential_ms / parallel_ms
+              << "x)" << (total->sum() == sequential->sum() ? "" : " (mismatch!)") << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,262 @@
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Components of Visitor.cpp as plain value classes. They carry a value so the
+ * benchmark visitors have something to compute.
+ */
+class ConcreteComponentA {
+ public:
+  explicit ConcreteComponentA(int value = 1) : value_(value) {}
+
+  std::string ExclusiveMethodOfConcreteComponentA() const {
+    return "A";
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+class ConcreteComponentB {
+ public:
+  explicit ConcreteComponentB(int value = 1) : value_(value) {}
+
+  std::string SpecialMethodOfConcreteComponentB() const {
+    return "B";
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+/**
+ * ComponentStore keeps one contiguous array per component class instead of a
+ * list of pointers to a common base. Accept() walks each array in turn and
+ * calls the visitor's matching Visit function directly: the visitor is a
+ * template parameter, so the call is bound at compile time and inlined, and
+ * each loop sees a single type laid out densely in memory, which is what lets
+ * the compiler vectorize it.
+ *
+ * The price is order: a visitor sees all A components, then all B
+ * components, not the order in which they were added.
+ */
+class ComponentStore {
+ public:
+  void Add(ConcreteComponentA component) {
+    as_.push_back(component);
+  }
+  void Add(ConcreteComponentB component) {
+    bs_.push_back(component);
+  }
+  void Reserve(std::size_t as, std::size_t bs) {
+    as_.reserve(as);
+    bs_.reserve(bs);
+  }
+  std::size_t size() const {
+    return as_.size() + bs_.size();
+  }
+
+  template <typename VisitorT>
+  void Accept(VisitorT& visitor) const {
+    for (const ConcreteComponentA& component : as_) {
+      visitor.VisitConcreteComponentA(component);
+    }
+    for (const ConcreteComponentB& component : bs_) {
+      visitor.VisitConcreteComponentB(component);
+    }
+  }
+
+ private:
+  std::vector<ConcreteComponentA> as_;
+  std::vector<ConcreteComponentB> bs_;
+};
+
+/**
+ * Concrete Visitors keep the method names of the Visitor interface, but need
+ * no common base class.
+ */
+class ConcreteVisitor1 {
+ public:
+  void VisitConcreteComponentA(const ConcreteComponentA& element) const {
+    std::cout << element.ExclusiveMethodOfConcreteComponentA() << " + ConcreteVisitor1\n";
+  }
+  void VisitConcreteComponentB(const ConcreteComponentB& element) const {
+    std::cout << element.SpecialMethodOfConcreteComponentB() << " + ConcreteVisitor1\n";
+  }
+};
+
+class ConcreteVisitor2 {
+ public:
+  void VisitConcreteComponentA(const ConcreteComponentA& element) const {
+    std::cout << element.ExclusiveMethodOfConcreteComponentA() << " + ConcreteVisitor2\n";
+  }
+  void VisitConcreteComponentB(const ConcreteComponentB& element) const {
+    std::cout << element.SpecialMethodOfConcreteComponentB() << " + ConcreteVisitor2\n";
+  }
+};
+
+// Weighted sum of the component values, used by the benchmark.
+class SumVisitor {
+ public:
+  void VisitConcreteComponentA(const ConcreteComponentA& element) {
+    sum_ += element.value();
+  }
+  void VisitConcreteComponentB(const ConcreteComponentB& element) {
+    sum_ += 3 * element.value();
+  }
+  std::int64_t sum() const {
+    return sum_;
+  }
+
+ private:
+  std::int64_t sum_ = 0;
+};
+
+template <typename VisitorT>
+void ClientCode(const ComponentStore& components, VisitorT& visitor) {
+  // ...
+  components.Accept(visitor);
+  // ...
+}
+
+/**
+ * The double-dispatch design of Visitor.cpp with the same SumVisitor, kept for
+ * the benchmark.
+ */
+namespace classic {
+
+class ConcreteComponentA;
+class ConcreteComponentB;
+
+class Visitor {
+ public:
+  virtual ~Visitor() {}
+  virtual void VisitConcreteComponentA(std::shared_ptr<ConcreteComponentA> element) = 0;
+  virtual void VisitConcreteComponentB(std::shared_ptr<ConcreteComponentB> element) = 0;
+};
+
+class Component {
+ public:
+  virtual ~Component() {}
+  virtual void Accept(std::shared_ptr<Visitor> visitor) = 0;
+};
+
+class ConcreteComponentA : public Component, public std::enable_shared_from_this<ConcreteComponentA> {
+ public:
+  explicit ConcreteComponentA(int value = 1) : value_(value) {}
+  void Accept(std::shared_ptr<Visitor> visitor) override {
+    visitor->VisitConcreteComponentA(shared_from_this());
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+class ConcreteComponentB : public Component, public std::enable_shared_from_this<ConcreteComponentB> {
+ public:
+  explicit ConcreteComponentB(int value = 1) : value_(value) {}
+  void Accept(std::shared_ptr<Visitor> visitor) override {
+    visitor->VisitConcreteComponentB(shared_from_this());
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+class SumVisitor : public Visitor {
+ public:
+  void VisitConcreteComponentA(std::shared_ptr<ConcreteComponentA> element) override {
+    sum_ += element->value();
+  }
+  void VisitConcreteComponentB(std::shared_ptr<ConcreteComponentB> element) override {
+    sum_ += 3 * element->value();
+  }
+  std::int64_t sum() const {
+    return sum_;
+  }
+
+ private:
+  std::int64_t sum_ = 0;
+};
+
+}  // namespace classic
+
+int main(int argc, char* argv[]) {
+  using Clock = std::chrono::steady_clock;
+
+  ComponentStore components;
+  components.Add(ConcreteComponentA());
+  components.Add(ConcreteComponentB());
+  std::cout << "The client code works with all visitors through the store:\n";
+  ConcreteVisitor1 visitor1;
+  ClientCode(components, visitor1);
+  std::cout << "\n";
+  std::cout << "It allows the same client code to work with different types of visitors:\n";
+  ConcreteVisitor2 visitor2;
+  ClientCode(components, visitor2);
+
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  std::cout << "\nBenchmark: " << count << " components, random mix of A and B, 4 passes\n";
+
+  ComponentStore store;
+  // About half of the components are of each class.
+  std::size_t per_class = count / 2 + count / 32 + 64;
+  store.Reserve(per_class, per_class);
+  std::vector<std::shared_ptr<classic::Component>> pointers;
+  pointers.reserve(count);
+  std::uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  for (std::size_t i = 0; i < count; ++i) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    int value = static_cast<int>(seed >> 60);
+    if (seed & 1) {
+      store.Add(ConcreteComponentA(value));
+      pointers.push_back(std::make_shared<classic::ConcreteComponentA>(value));
+    } else {
+      store.Add(ConcreteComponentB(value));
+      pointers.push_back(std::make_shared<classic::ConcreteComponentB>(value));
+    }
+  }
+
+  const int kPasses = 4;
+  std::shared_ptr<classic::SumVisitor> classic_visitor = std::make_shared<classic::SumVisitor>();
+  Clock::time_point start = Clock::now();
+  for (int pass = 0; pass < kPasses; ++pass) {
+    for (const std::shared_ptr<classic::Component>& comp : pointers) {
+      comp->Accept(classic_visitor);
+    }
+  }
+  double classic_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kPasses;
+
+  SumVisitor store_visitor;
+  start = Clock::now();
+  for (int pass = 0; pass < kPasses; ++pass) {
+    ClientCode(store, store_visitor);
+  }
+  double store_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kPasses;
+
+  std::cout << "  double dispatch + shared_ptr: " << classic_ms << " ms/pass (sum " << classic_visitor->sum() << ")\n";
+  std::cout << "  type-partitioned store      : " << store_ms << " ms/pass (sum " << store_visitor.sum() << ")"
+            << (store_visitor.sum() == classic_visitor->sum() ? "" : " (mismatch!)") << "\n";
+  std::cout << "  speedup                     : " << classic_ms / store_ms << "x, "
+            << count * 1e-6 / (store_ms * 1e-3) << " M components/s\n";
+  return 0;
+}
@@ -0,0 +1,225 @@
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+/**
+ * A closed version of Visitor.cpp. The set of component classes is fixed, so
+ * a component is a std::variant of the concrete classes and is stored by
+ * value. A visitor is any callable with one overload per component class;
+ * std::visit picks the overload from the variant's index, with no virtual
+ * Accept, no shared_from_this() and no reference counting.
+ *
+ * The components carry a value so the benchmark visitors have something to
+ * compute.
+ */
+class ConcreteComponentA {
+ public:
+  explicit ConcreteComponentA(int value = 1) : value_(value) {}
+
+  std::string ExclusiveMethodOfConcreteComponentA() const {
+    return "A";
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+class ConcreteComponentB {
+ public:
+  explicit ConcreteComponentB(int value = 1) : value_(value) {}
+
+  std::string SpecialMethodOfConcreteComponentB() const {
+    return "B";
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+using Component = std::variant<ConcreteComponentA, ConcreteComponentB>;
+
+/**
+ * Concrete Visitors implement several versions of the same algorithm, one
+ * overload per component class. Leaving one out is a compile error.
+ */
+class ConcreteVisitor1 {
+ public:
+  void operator()(const ConcreteComponentA& element) const {
+    std::cout << element.ExclusiveMethodOfConcreteComponentA() << " + ConcreteVisitor1\n";
+  }
+  void operator()(const ConcreteComponentB& element) const {
+    std::cout << element.SpecialMethodOfConcreteComponentB() << " + ConcreteVisitor1\n";
+  }
+};
+
+class ConcreteVisitor2 {
+ public:
+  void operator()(const ConcreteComponentA& element) const {
+    std::cout << element.ExclusiveMethodOfConcreteComponentA() << " + ConcreteVisitor2\n";
+  }
+  void operator()(const ConcreteComponentB& element) const {
+    std::cout << element.SpecialMethodOfConcreteComponentB() << " + ConcreteVisitor2\n";
+  }
+};
+
+// Weighted sum of the component values, used by the benchmark.
+class SumVisitor {
+ public:
+  void operator()(const ConcreteComponentA& element) {
+    sum_ += element.value();
+  }
+  void operator()(const ConcreteComponentB& element) {
+    sum_ += 3 * element.value();
+  }
+  std::int64_t sum() const {
+    return sum_;
+  }
+
+ private:
+  std::int64_t sum_ = 0;
+};
+
+/**
+ * The client code takes the components by reference; nothing is copied.
+ */
+template <typename VisitorT>
+void ClientCode(const std::vector<Component>& components, VisitorT& visitor) {
+  // ...
+  for (const Component& comp : components) {
+    std::visit(visitor, comp);
+  }
+  // ...
+}
+
+/**
+ * The double-dispatch design of Visitor.cpp with the same SumVisitor, kept for
+ * the benchmark.
+ */
+namespace classic {
+
+class ConcreteComponentA;
+class ConcreteComponentB;
+
+class Visitor {
+ public:
+  virtual ~Visitor() {}
+  virtual void VisitConcreteComponentA(std::shared_ptr<ConcreteComponentA> element) = 0;
+  virtual void VisitConcreteComponentB(std::shared_ptr<ConcreteComponentB> element) = 0;
+};
+
+class Component {
+ public:
+  virtual ~Component() {}
+  virtual void Accept(std::shared_ptr<Visitor> visitor) = 0;
+};
+
+class ConcreteComponentA : public Component, public std::enable_shared_from_this<ConcreteComponentA> {
+ public:
+  explicit ConcreteComponentA(int value = 1) : value_(value) {}
+  void Accept(std::shared_ptr<Visitor> visitor) override {
+    visitor->VisitConcreteComponentA(shared_from_this());
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+class ConcreteComponentB : public Component, public std::enable_shared_from_this<ConcreteComponentB> {
+ public:
+  explicit ConcreteComponentB(int value = 1) : value_(value) {}
+  void Accept(std::shared_ptr<Visitor> visitor) override {
+    visitor->VisitConcreteComponentB(shared_from_this());
+  }
+  int value() const {
+    return value_;
+  }
+
+ private:
+  int value_;
+};
+
+class SumVisitor : public Visitor {
+ public:
+  void VisitConcreteComponentA(std::shared_ptr<ConcreteComponentA> element) override {
+    sum_ += element->value();
+  }
+  void VisitConcreteComponentB(std::shared_ptr<ConcreteComponentB> element) override {
+    sum_ += 3 * element->value();
+  }
+  std::int64_t sum() const {
+    return sum_;
+  }
+
+ private:
+  std::int64_t sum_ = 0;
+};
+
+}  // namespace classic
+
+int main(int argc, char* argv[]) {
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<Component> components = {ConcreteComponentA(), ConcreteComponentB()};
+  std::cout << "The client code works with all visitors through std::visit:\n";
+  ConcreteVisitor1 visitor1;
+  ClientCode(components, visitor1);
+  std::cout << "\n";
+  std::cout << "It allows the same client code to work with different types of visitors:\n";
+  ConcreteVisitor2 visitor2;
+  ClientCode(components, visitor2);
+
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  std::cout << "\nBenchmark: " << count << " components, random mix of A and B\n";
+
+  std::vector<Component> values;
+  std::vector<std::shared_ptr<classic::Component>> pointers;
+  values.reserve(count);
+  pointers.reserve(count);
+  std::uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  for (std::size_t i = 0; i < count; ++i) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    int value = static_cast<int>(seed >> 60);
+    if (seed & 1) {
+      values.emplace_back(ConcreteComponentA(value));
+      pointers.push_back(std::make_shared<classic::ConcreteComponentA>(value));
+    } else {
+      values.emplace_back(ConcreteComponentB(value));
+      pointers.push_back(std::make_shared<classic::ConcreteComponentB>(value));
+    }
+  }
+
+  std::shared_ptr<classic::SumVisitor> classic_visitor = std::make_shared<classic::SumVisitor>();
+  Clock::time_point start = Clock::now();
+  for (const std::shared_ptr<classic::Component>& comp : pointers) {
+    comp->Accept(classic_visitor);
+  }
+  double classic_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  SumVisitor variant_visitor;
+  start = Clock::now();
+  ClientCode(values, variant_visitor);
+  double variant_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  std::cout << "  double dispatch + shared_ptr: " << classic_ms << " ms (sum " << classic_visitor->sum() << ")\n";
+  std::cout << "  std::variant + std::visit   : " << variant_ms << " ms (sum " << variant_visitor.sum() << ")\n";
+  std::cout << "  speedup                     : " << classic_ms / variant_ms << "x\n";
+  std::cout << "  storage per component       : " << sizeof(Component) << " bytes by value vs "
+            << sizeof(std::shared_ptr<classic::Component>) << " byte pointer + heap object\n";
+  return 0;
+}
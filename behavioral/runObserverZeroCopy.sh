@@ -0,0 +1,3 @@
+#!/bin/bash
+file=ObserverZeroCopy
+valgrind --leak-check=full --show-leak-kinds=all --track-origins=yes --verbose --log-file=${file}-out.txt _install/bin/${file}